@@ -21,6 +21,7 @@
 
 #include <radix/asm/msr.h>
 #include <radix/cpu.h>
+#include <radix/cpumask.h>
 #include <radix/error.h>
 #include <radix/kernel.h>
 #include <radix/mm.h>
@@ -66,6 +67,14 @@ static unsigned int ioapics_available;
 #define IOAPIC_REG_ID   0
 #define IOAPIC_REG_VER  1
 #define IOAPIC_REG_ARB  2
+#define IOAPIC_REG_REDTBL(pin) (0x10 + 2 * (pin))
+
+#define IOAPIC_REDIR_ACTIVE_LOW (1 << 13)
+#define IOAPIC_REDIR_LEVEL      (1 << 15)
+
+#define APIC_REG_EOI    0xB0
+
+static int apic_active;
 
 DEFINE_PER_CPU(int, apic_id);
 
@@ -115,12 +124,12 @@ static void apic_enable(addr_t base)
 	wrmsr(IA32_APIC_BASE, (base & PAGE_MASK) | IA32_APIC_BASE_ENABLE, 0);
 }
 
-static uint32_t apic_reg_read(uint16_t reg)
+uint32_t apic_reg_read(uint16_t reg)
 {
 	return *(uint32_t *)(lapic_virt_base + reg);
 }
 
-static void apic_reg_write(uint16_t reg, uint32_t value)
+void apic_reg_write(uint16_t reg, uint32_t value)
 {
 	*(uint32_t *)(lapic_virt_base + reg) = value;
 }
@@ -167,11 +176,74 @@ void apic_init(void)
 
 	/* Enable APIC and set spurious interrupt vector */
 	apic_reg_write(0xF0, 0x100 | SPURIOUS_INTERRUPT);
+
+	read_apic_id();
+	apic_active = 1;
+}
+
+/* apic_enabled: return 1 if interrupts are delivered through the APIC */
+int apic_enabled(void)
+{
+	return apic_active;
+}
+
+/* apic_eoi: signal the end of an interrupt to the local APIC */
+void apic_eoi(void)
+{
+	apic_reg_write(APIC_REG_EOI, 0);
+}
+
+/*
+ * ioapic_route_gsi:
+ * Route global system interrupt `gsi` to interrupt vector `vec` on the
+ * executing processor. `flags` hold the interrupt's MADT polarity and
+ * trigger mode.
+ */
+int ioapic_route_gsi(unsigned int gsi, unsigned int vec, unsigned int flags)
+{
+	struct ioapic *ioapic;
+	uint32_t low;
+	unsigned int pin;
+
+	ioapic = ioapic_from_vector(gsi);
+	if (!ioapic)
+		return ENODEV;
+
+	pin = gsi - ioapic->irq_base;
+	low = vec;
+	if ((flags & 3) == ACPI_MADT_INTI_POLARITY_ACTIVE_LOW)
+		low |= IOAPIC_REDIR_ACTIVE_LOW;
+	if ((flags & (3 << 2)) == ACPI_MADT_INTI_TRIGGER_MODE_LEVEL)
+		low |= IOAPIC_REDIR_LEVEL;
+
+	ioapic_reg_write(ioapic, IOAPIC_REG_REDTBL(pin) + 1,
+	                 (uint32_t)this_cpu_read(apic_id) << 24);
+	ioapic_reg_write(ioapic, IOAPIC_REG_REDTBL(pin), low);
+
+	return 0;
+}
+
+/*
+ * ioapic_route_irq:
+ * Route legacy ISA IRQ `irq` to interrupt vector `vec`
+ * on the executing processor.
+ */
+int ioapic_route_irq(unsigned int irq, unsigned int vec)
+{
+	struct irq_map *map;
+
+	if (irq >= ARRAY_SIZE(bus_irqs))
+		return EINVAL;
+
+	map = &bus_irqs[irq];
+	return ioapic_route_gsi(map->global_irq, vec, map->flags);
 }
 
 static void apic_parse_lapic(struct acpi_madt_local_apic *s)
 {
-	cpus_available += s->flags & 1;
+	/* count processors which are either enabled or online capable */
+	if (s->flags & 3)
+		cpus_available++;
 }
 
 static void apic_parse_ioapic(struct acpi_madt_io_apic *s)
@@ -211,6 +283,19 @@ static void apic_parse_override(struct acpi_madt_interrupt_override *s)
 	bus_irqs[s->irq_source].flags = s->flags;
 }
 
+/*
+ * i386_possible_cpus:
+ * Return the number of processors in the system, as reported by the MADT.
+ * Without a MADT, only the bootstrap processor is assumed to exist.
+ */
+unsigned int i386_possible_cpus(void)
+{
+	if (!cpus_available)
+		return 1;
+
+	return min(cpus_available, MAX_CPUS);
+}
+
 /*
  * apic_parse_madt:
  * Check that the MADT ACPI table exists and is valid, and store pointer to it.
@@ -19,9 +19,21 @@
 #ifndef ARCH_I386_APIC_H
 #define ARCH_I386_APIC_H
 
-#define SPURIOUS_INTERRUPT 0xFF
+#include <radix/types.h>
+
+#define APIC_TIMER_INTERRUPT 0xF0
+#define SPURIOUS_INTERRUPT   0xFF
 
 int apic_parse_madt(void);
 void apic_init(void);
+int apic_enabled(void);
+void apic_eoi(void);
+uint32_t apic_reg_read(uint16_t reg);
+void apic_reg_write(uint16_t reg, uint32_t value);
+int ioapic_route_gsi(unsigned int gsi, unsigned int vec, unsigned int flags);
+int ioapic_route_irq(unsigned int irq, unsigned int vec);
+
+void apic_timer_init(void);
+void apic_timer_setup(void);
 
 #endif /* ARCH_I386_APIC_H */
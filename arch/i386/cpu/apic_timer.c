@@ -0,0 +1,194 @@
+/*
+ * arch/i386/cpu/apic_timer.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/asm/msr.h>
+#include <radix/clockevent.h>
+#include <radix/cpu.h>
+#include <radix/irq.h>
+#include <radix/kernel.h>
+#include <radix/percpu.h>
+#include <radix/smp.h>
+#include <radix/tick.h>
+
+#include "apic.h"
+#include "pit.h"
+#include "tsc.h"
+
+#define APIC_REG_LVT_TIMER      0x320
+#define APIC_REG_TIMER_ICR      0x380   /* initial count */
+#define APIC_REG_TIMER_CCR      0x390   /* current count */
+#define APIC_REG_TIMER_DCR      0x3E0   /* divide configuration */
+
+#define APIC_LVT_MASKED         (1 << 16)
+#define APIC_TIMER_ONESHOT      (0 << 17)
+#define APIC_TIMER_PERIODIC     (1 << 17)
+#define APIC_TIMER_TSC_DEADLINE (2 << 17)
+
+#define APIC_TIMER_DIV_16       0x3
+
+/*
+ * Each processor's local APIC timer is registered as a clock event device
+ * interrupting only that processor. Where supported, one-shot events are
+ * programmed as absolute TSC deadlines, which avoids converting between
+ * the TSC and APIC bus clock domains. Otherwise, the timer counts down
+ * at the APIC bus frequency divided by 16.
+ */
+static DEFINE_PER_CPU(struct clock_event_device, apic_timer_events);
+
+/* Calibrated frequency; zero if unknown. */
+static uint32_t apic_timer_freq;
+
+static int apic_timer_deadline;
+
+static void apic_timer_set_mode(struct clock_event_device *dev,
+                                unsigned int mode)
+{
+	(void)dev;
+
+	switch (mode) {
+	case CLOCK_EVT_MODE_PERIODIC:
+		apic_reg_write(APIC_REG_TIMER_DCR, APIC_TIMER_DIV_16);
+		apic_reg_write(APIC_REG_LVT_TIMER,
+		               APIC_TIMER_PERIODIC | APIC_TIMER_INTERRUPT);
+		apic_reg_write(APIC_REG_TIMER_ICR, apic_timer_freq / HZ);
+		break;
+	case CLOCK_EVT_MODE_ONESHOT:
+		if (apic_timer_deadline) {
+			apic_reg_write(APIC_REG_LVT_TIMER,
+			               APIC_TIMER_TSC_DEADLINE |
+			               APIC_TIMER_INTERRUPT);
+		} else {
+			apic_reg_write(APIC_REG_TIMER_DCR, APIC_TIMER_DIV_16);
+			apic_reg_write(APIC_REG_LVT_TIMER,
+			               APIC_TIMER_ONESHOT |
+			               APIC_TIMER_INTERRUPT);
+		}
+		break;
+	default:
+		apic_reg_write(APIC_REG_LVT_TIMER,
+		               APIC_LVT_MASKED | APIC_TIMER_INTERRUPT);
+		apic_reg_write(APIC_REG_TIMER_ICR, 0);
+		if (apic_timer_deadline)
+			wrmsr(IA32_TSC_DEADLINE, 0, 0);
+		break;
+	}
+}
+
+static int apic_timer_next_event(struct clock_event_device *dev,
+                                 unsigned long cycles)
+{
+	(void)dev;
+
+	apic_reg_write(APIC_REG_TIMER_ICR, cycles);
+	return 0;
+}
+
+static int apic_timer_next_deadline(struct clock_event_device *dev,
+                                    unsigned long cycles)
+{
+	uint64_t deadline;
+
+	(void)dev;
+
+	deadline = rdtsc() + cycles;
+	wrmsr(IA32_TSC_DEADLINE, (uint32_t)deadline, (uint32_t)(deadline >> 32));
+	return 0;
+}
+
+static void apic_timer_irq(struct regs *r)
+{
+	struct clock_event_device *dev;
+
+	dev = raw_cpu_ptr(&apic_timer_events);
+	if (dev->event_handler)
+		dev->event_handler(dev, r);
+}
+
+/*
+ * apic_timer_calibrate:
+ * Measure the frequency of the APIC timer against a PIT countdown.
+ */
+static void apic_timer_calibrate(void)
+{
+	uint32_t count;
+	unsigned long flags;
+
+	irq_save(flags);
+	apic_reg_write(APIC_REG_TIMER_DCR, APIC_TIMER_DIV_16);
+	apic_reg_write(APIC_REG_LVT_TIMER,
+	               APIC_LVT_MASKED | APIC_TIMER_INTERRUPT);
+
+	pit_calibrate_start();
+	apic_reg_write(APIC_REG_TIMER_ICR, 0xFFFFFFFF);
+	pit_calibrate_wait();
+	count = 0xFFFFFFFF - apic_reg_read(APIC_REG_TIMER_CCR);
+
+	apic_reg_write(APIC_REG_TIMER_ICR, 0);
+	irq_restore(flags);
+
+	apic_timer_freq = count * (MSEC_PER_SEC / PIT_CALIBRATE_MS);
+}
+
+/*
+ * apic_timer_setup:
+ * Register the executing processor's APIC timer as a clock event device.
+ */
+void apic_timer_setup(void)
+{
+	struct clock_event_device *dev;
+
+	dev = raw_cpu_ptr(&apic_timer_events);
+	dev->name = "lapic";
+	dev->cpu = processor_id();
+	dev->set_mode = apic_timer_set_mode;
+
+	if (apic_timer_deadline) {
+		dev->features = CLOCK_EVT_FEAT_ONESHOT;
+		dev->rating = 160;
+		dev->set_next_event = apic_timer_next_deadline;
+		clockevents_config_khz(dev, tsc_khz, 0xF, 0x7FFFFFFF);
+	} else {
+		dev->features = CLOCK_EVT_FEAT_PERIODIC |
+		                CLOCK_EVT_FEAT_ONESHOT;
+		dev->rating = 150;
+		dev->set_next_event = apic_timer_next_event;
+		clockevents_config(dev, apic_timer_freq, 0xF, 0xFFFFFFFF);
+	}
+
+	clockevents_register_device(dev);
+}
+
+/*
+ * apic_timer_init:
+ * Calibrate the APIC timer and set it up on the bootstrap processor.
+ * Requires the PIT for calibration, and the TSC to be calibrated
+ * for deadline mode.
+ */
+void apic_timer_init(void)
+{
+	if (!apic_enabled())
+		return;
+
+	apic_timer_calibrate();
+	if (!apic_timer_freq)
+		return;
+
+	apic_timer_deadline = cpu_supports(CPUID_TSC_DL) && tsc_khz;
+	install_interrupt_handler(APIC_TIMER_INTERRUPT, apic_timer_irq);
+	apic_timer_setup();
+}
@@ -35,6 +35,9 @@ static char vendor_id[16];
 static unsigned long cpu_info[4];
 static uint64_t cpu_features;
 
+/* TSC runs at a constant rate in all power states */
+static int tsc_invariant;
+
 struct cpu_cache {
 	/* id[0..3]: level; id[4..7]: type */
 	unsigned char   id;
@@ -146,6 +149,12 @@ int cpu_supports(uint64_t features)
 	return !!(cpu_features & features);
 }
 
+/* cpu_tsc_invariant: return 1 if the TSC rate is constant */
+int cpu_tsc_invariant(void)
+{
+	return tsc_invariant;
+}
+
 static void add_cache(unsigned char level, unsigned char type,
                       unsigned long size, unsigned long line_size,
                       unsigned long assoc)
@@ -827,14 +836,15 @@ char *cpu_name(void)
  */
 static void extended_processor_info(void)
 {
-	unsigned long buf[4];
+	unsigned long buf[4], max;
 	char *pos;
 	unsigned int i;
 
 	cpuid(0x80000000, buf[0], buf[1], buf[2], buf[3]);
+	max = buf[0];
 
 	/* read full processor name */
-	if (buf[0] >= 0x80000004) {
+	if (max >= 0x80000004) {
 		pos = processor_name;
 		for (i = 0x80000002; i < 0x80000005; ++i) {
 			cpuid(i, buf[0], buf[1], buf[2], buf[3]);
@@ -842,6 +852,11 @@ static void extended_processor_info(void)
 			pos += 0x10;
 		}
 	}
+
+	if (max >= 0x80000007) {
+		cpuid(0x80000007, buf[0], buf[1], buf[2], buf[3]);
+		tsc_invariant = !!(buf[3] & (1 << 8));
+	}
 }
 
 /*
@@ -999,6 +1014,8 @@ char *i386_cache_str(void)
 
 DEFINE_PER_CPU(int, processor_id);
 
+struct cpumask __cpu_online_mask;
+
 void bsp_init(void)
 {
 	gdt_init_early();
@@ -1007,6 +1024,7 @@ void bsp_init(void)
 	read_cpu_info();
 
 	this_cpu_write(processor_id, 0);
+	cpumask_set_cpu(0, cpu_online_mask);
 	if (cpu_supports(CPUID_PGE))
 		cpu_modify_cr4(0, CR4_PGE);
 }
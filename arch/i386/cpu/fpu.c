@@ -0,0 +1,216 @@
+/*
+ * arch/i386/cpu/fpu.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/cpu.h>
+#include <radix/error.h>
+#include <radix/fpu.h>
+#include <radix/irq.h>
+#include <radix/kernel.h>
+#include <radix/percpu.h>
+#include <radix/preempt.h>
+#include <radix/slab.h>
+#include <radix/smp.h>
+#include <radix/task.h>
+
+#include <rlibc/string.h>
+
+#define MXCSR_DEFAULT 0x1F80
+
+static struct slab_cache *fpu_cache;
+static int fpu_fxsr;
+
+/* task whose state was last loaded into the processor's FPU registers */
+static DEFINE_PER_CPU(struct task *, fpu_owner);
+
+/* set while the owner's registers may be newer than its saved state */
+static DEFINE_PER_CPU(int, fpu_live);
+
+static __always_inline void clts(void)
+{
+	asm volatile("clts");
+}
+
+static __always_inline void stts(void)
+{
+	cpu_modify_cr0(0, CR0_TS);
+}
+
+static __always_inline void fpu_save(struct fpu *fpu)
+{
+	if (fpu_fxsr)
+		asm volatile("fxsave %0" : "=m"(fpu->state));
+	else
+		asm volatile("fnsave %0; fwait" : "=m"(fpu->state));
+}
+
+static __always_inline void fpu_restore(struct fpu *fpu)
+{
+	if (fpu_fxsr)
+		asm volatile("fxrstor %0" : : "m"(fpu->state));
+	else
+		asm volatile("frstor %0" : : "m"(fpu->state));
+}
+
+static __always_inline void fpu_reset(void)
+{
+	uint32_t mxcsr = MXCSR_DEFAULT;
+
+	asm volatile("fninit");
+	if (cpu_supports(CPUID_SSE))
+		asm volatile("ldmxcsr %0" : : "m"(mxcsr));
+}
+
+/*
+ * fpu_trap:
+ * Device not available exception handler. Raised on the first FPU
+ * instruction a task executes after being switched to, at which point
+ * its state is loaded into the registers.
+ */
+static void fpu_trap(struct regs *r, int error)
+{
+	struct task *curr;
+	struct fpu *fpu;
+	int cpu;
+
+	(void)r;
+	(void)error;
+
+	clts();
+	curr = current_task();
+	if (unlikely(!curr))
+		return;
+
+	cpu = processor_id();
+	fpu = curr->fpu;
+	if (!fpu) {
+		fpu = alloc_cache(fpu_cache);
+		if (IS_ERR(fpu))
+			panic("failed to allocate FPU state for task %d: %s\n",
+			      curr->pid, strerror(ERR_VAL(fpu)));
+		curr->fpu = fpu;
+		fpu_reset();
+	} else if (this_cpu_read(fpu_owner) != curr || fpu->last_cpu != cpu) {
+		/* the registers hold some other task's state */
+		fpu_restore(fpu);
+	}
+
+	fpu->last_cpu = cpu;
+	this_cpu_write(fpu_owner, curr);
+	this_cpu_write(fpu_live, 1);
+}
+
+/*
+ * x86_fpu_init:
+ * Enable the FPU and SSE and set up lazy switching of their state.
+ */
+void x86_fpu_init(void)
+{
+	if (!cpu_supports(CPUID_FPU))
+		return;
+
+	cpu_modify_cr0(CR0_EM, CR0_MP | CR0_NE);
+	if (cpu_supports(CPUID_FXSR)) {
+		fpu_fxsr = 1;
+		if (cpu_supports(CPUID_SSE))
+			cpu_modify_cr4(0, CR4_OSFXSR | CR4_OSXMMEXCPT);
+		else
+			cpu_modify_cr4(0, CR4_OSFXSR);
+	}
+	fpu_reset();
+
+	fpu_cache = create_cache("fpu_cache", sizeof (struct fpu), 16,
+	                         SLAB_PANIC, NULL, NULL);
+	install_exception_handler(X86_EXCEPTION_NM, fpu_trap);
+	stts();
+}
+
+/*
+ * x86_fpu_switch_out:
+ * Save the FPU state of `prev`, which is being switched away from, if it
+ * was used since it was switched to. Called with interrupts disabled.
+ */
+void x86_fpu_switch_out(struct task *prev)
+{
+	if (!this_cpu_read(fpu_live))
+		return;
+
+	fpu_save(prev->fpu);
+	this_cpu_write(fpu_live, 0);
+	stts();
+
+	/* fnsave reinitializes the FPU, so the registers must be reloaded */
+	if (!fpu_fxsr)
+		this_cpu_write(fpu_owner, NULL);
+}
+
+/*
+ * x86_fpu_task_exit:
+ * Release the FPU state of `task`, which is being destroyed.
+ */
+void x86_fpu_task_exit(struct task *task)
+{
+	unsigned long flags;
+
+	irq_save(flags);
+	if (this_cpu_read(fpu_owner) == task) {
+		this_cpu_write(fpu_owner, NULL);
+		if (this_cpu_read(fpu_live)) {
+			this_cpu_write(fpu_live, 0);
+			stts();
+		}
+	}
+	irq_restore(flags);
+
+	if (task->fpu) {
+		free_cache(fpu_cache, task->fpu);
+		task->fpu = NULL;
+	}
+}
+
+/*
+ * x86_kernel_fpu_begin:
+ * Allow the kernel to use FPU and SIMD registers until the next call to
+ * kernel_fpu_end. The running task's state is saved first if loaded.
+ */
+void x86_kernel_fpu_begin(void)
+{
+	unsigned long flags;
+
+	preempt_disable();
+
+	irq_save(flags);
+	if (this_cpu_read(fpu_live)) {
+		fpu_save(this_cpu_read(fpu_owner)->fpu);
+		this_cpu_write(fpu_live, 0);
+	}
+	/* the registers are about to be clobbered */
+	this_cpu_write(fpu_owner, NULL);
+	clts();
+	irq_restore(flags);
+}
+
+/*
+ * x86_kernel_fpu_end:
+ * End a kernel FPU section. The running task's state is reloaded
+ * when it next uses the FPU.
+ */
+void x86_kernel_fpu_end(void)
+{
+	stts();
+	preempt_enable();
+}
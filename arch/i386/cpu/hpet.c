@@ -0,0 +1,287 @@
+/*
+ * arch/i386/cpu/hpet.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <acpi/acpi.h>
+#include <acpi/tables/hpet.h>
+#include <acpi/tables/madt.h>
+
+#include <radix/clockevent.h>
+#include <radix/clocksource.h>
+#include <radix/error.h>
+#include <radix/irq.h>
+#include <radix/kernel.h>
+#include <radix/math64.h>
+#include <radix/mm.h>
+#include <radix/smp.h>
+#include <radix/tick.h>
+#include <radix/vmm.h>
+
+#include "apic.h"
+#include "hpet.h"
+
+#define HPET_REG_ID             0x000
+#define HPET_REG_PERIOD         0x004
+#define HPET_REG_CONFIG         0x010
+#define HPET_REG_COUNTER        0x0F0
+#define HPET_REG_TN_CONFIG(n)   (0x100 + 0x20 * (n))
+#define HPET_REG_TN_ROUTE(n)    (0x104 + 0x20 * (n))
+#define HPET_REG_TN_CMP(n)      (0x108 + 0x20 * (n))
+
+#define HPET_ID_NUM_TIMERS(id)  ((((id) >> 8) & 0x1F) + 1)
+
+#define HPET_CFG_ENABLE         (1 << 0)
+#define HPET_CFG_LEGACY         (1 << 1)
+
+#define HPET_TN_LEVEL           (1 << 1)
+#define HPET_TN_ENABLE          (1 << 2)
+#define HPET_TN_PERIODIC        (1 << 3)
+#define HPET_TN_PERIODIC_CAP    (1 << 4)
+#define HPET_TN_SETVAL          (1 << 6)
+#define HPET_TN_32BIT           (1 << 8)
+#define HPET_TN_ROUTE_SHIFT     9
+#define HPET_TN_ROUTE_MASK      (0x1F << HPET_TN_ROUTE_SHIFT)
+#define HPET_TN_FSB             (1 << 14)
+
+/* femtoseconds per second */
+#define FSEC_PER_SEC            1000000000000000ULL
+
+/* Shortest comparator interval which can reliably be programmed. */
+#define HPET_MIN_CYCLES         128
+
+static volatile uint32_t *hpet_base;
+static uint32_t hpet_frequency;
+
+struct hpet_timer {
+	struct clock_event_device       evt;
+	unsigned int                    num;
+	uint32_t                        period;
+};
+
+static struct hpet_timer hpet_timers[HPET_MAX_TIMERS];
+static unsigned int hpet_nr_timers;
+
+static __always_inline uint32_t hpet_readl(unsigned int reg)
+{
+	return hpet_base[reg / 4];
+}
+
+static __always_inline void hpet_writel(unsigned int reg, uint32_t val)
+{
+	hpet_base[reg / 4] = val;
+}
+
+/* hpet_read_counter: read the low 32 bits of the HPET main counter */
+uint32_t hpet_read_counter(void)
+{
+	return hpet_readl(HPET_REG_COUNTER);
+}
+
+/* hpet_freq: return the main counter frequency, or 0 without an HPET */
+uint32_t hpet_freq(void)
+{
+	return hpet_frequency;
+}
+
+static uint64_t hpet_clocksource_read(struct clocksource *cs)
+{
+	(void)cs;
+
+	return hpet_read_counter();
+}
+
+/*
+ * Only the low half of the main counter is read, as a 64-bit read is not
+ * atomic on i386. At the usual frequencies it wraps every few minutes,
+ * much longer than the time between timekeeping updates.
+ */
+static struct clocksource clocksource_hpet = {
+	.name   = "hpet",
+	.rating = 250,
+	.read   = hpet_clocksource_read,
+	.mask   = CLOCKSOURCE_MASK(32)
+};
+
+static void hpet_set_mode(struct clock_event_device *dev, unsigned int mode)
+{
+	struct hpet_timer *t;
+	uint32_t cfg, now;
+
+	t = container_of(dev, struct hpet_timer, evt);
+	cfg = hpet_readl(HPET_REG_TN_CONFIG(t->num));
+	cfg &= ~(HPET_TN_ENABLE | HPET_TN_PERIODIC | HPET_TN_SETVAL);
+
+	switch (mode) {
+	case CLOCK_EVT_MODE_PERIODIC:
+		/* the first write sets the comparator, the second the period */
+		now = hpet_read_counter();
+		hpet_writel(HPET_REG_TN_CONFIG(t->num), cfg | HPET_TN_ENABLE |
+		            HPET_TN_PERIODIC | HPET_TN_SETVAL);
+		hpet_writel(HPET_REG_TN_CMP(t->num), now + t->period);
+		hpet_writel(HPET_REG_TN_CMP(t->num), t->period);
+		break;
+	case CLOCK_EVT_MODE_ONESHOT:
+		hpet_writel(HPET_REG_TN_CONFIG(t->num), cfg | HPET_TN_ENABLE);
+		break;
+	default:
+		hpet_writel(HPET_REG_TN_CONFIG(t->num), cfg);
+		break;
+	}
+}
+
+static int hpet_next_event(struct clock_event_device *dev,
+                           unsigned long cycles)
+{
+	struct hpet_timer *t;
+	uint32_t cmp;
+
+	t = container_of(dev, struct hpet_timer, evt);
+	cmp = hpet_read_counter() + cycles;
+	hpet_writel(HPET_REG_TN_CMP(t->num), cmp);
+
+	/*
+	 * The comparator only matches on equality, so an event
+	 * which is already in the past would not fire until
+	 * the counter wraps around.
+	 */
+	if ((int32_t)(hpet_read_counter() - cmp) >= 0)
+		return ETIME;
+
+	return 0;
+}
+
+static __always_inline void hpet_irq(unsigned int i, struct regs *r)
+{
+	if (hpet_timers[i].evt.event_handler)
+		hpet_timers[i].evt.event_handler(&hpet_timers[i].evt, r);
+}
+
+/* Interrupt handlers are not passed their vector, so each timer has one. */
+static void hpet_irq0(struct regs *r) { hpet_irq(0, r); }
+static void hpet_irq1(struct regs *r) { hpet_irq(1, r); }
+static void hpet_irq2(struct regs *r) { hpet_irq(2, r); }
+static void hpet_irq3(struct regs *r) { hpet_irq(3, r); }
+
+static void (*hpet_irq_handlers[HPET_MAX_TIMERS])(struct regs *) = {
+	hpet_irq0, hpet_irq1, hpet_irq2, hpet_irq3
+};
+
+/*
+ * hpet_setup_timer:
+ * Route comparator `num` to a free I/O APIC input and
+ * register it as a one-shot clock event device.
+ */
+static void hpet_setup_timer(unsigned int num)
+{
+	struct hpet_timer *t;
+	uint32_t cfg, routes;
+	unsigned int gsi, vec, slot;
+
+	slot = hpet_nr_timers;
+	cfg = hpet_readl(HPET_REG_TN_CONFIG(num));
+	routes = hpet_readl(HPET_REG_TN_ROUTE(num));
+
+	/* avoid the inputs used by legacy ISA devices */
+	routes &= ~0xFFFFUL;
+	if (!routes)
+		return;
+
+	gsi = __builtin_ctz(routes);
+	vec = HPET_INTERRUPT_BASE + slot;
+	if (ioapic_route_gsi(gsi, vec, ACPI_MADT_INTI_POLARITY_ACTIVE_HIGH |
+	                               ACPI_MADT_INTI_TRIGGER_MODE_EDGE) != 0)
+		return;
+
+	cfg &= ~(HPET_TN_ROUTE_MASK | HPET_TN_LEVEL | HPET_TN_FSB |
+	         HPET_TN_ENABLE | HPET_TN_PERIODIC);
+	cfg |= HPET_TN_32BIT | (gsi << HPET_TN_ROUTE_SHIFT);
+	hpet_writel(HPET_REG_TN_CONFIG(num), cfg);
+
+	t = &hpet_timers[slot];
+	t->num = num;
+	t->period = (hpet_frequency + HZ / 2) / HZ;
+	t->evt.name = "hpet";
+	t->evt.features = CLOCK_EVT_FEAT_ONESHOT;
+	if (cfg & HPET_TN_PERIODIC_CAP)
+		t->evt.features |= CLOCK_EVT_FEAT_PERIODIC;
+	t->evt.rating = 110;
+	t->evt.cpu = processor_id();
+	t->evt.set_mode = hpet_set_mode;
+	t->evt.set_next_event = hpet_next_event;
+
+	hpet_nr_timers++;
+	install_interrupt_handler(vec, hpet_irq_handlers[slot]);
+	clockevents_config(&t->evt, hpet_frequency,
+	                   HPET_MIN_CYCLES, 0x7FFFFFFF);
+	clockevents_register_device(&t->evt);
+}
+
+/*
+ * hpet_init:
+ * Find the HPET through ACPI, start its main counter and register it as
+ * a clocksource. Its comparators are registered as clock event devices
+ * if they can be routed through the I/O APIC.
+ */
+int hpet_init(void)
+{
+	struct acpi_hpet *hpet;
+	addr_t base, phys;
+	uint32_t period, ntimers, i;
+
+	hpet = acpi_find_table(ACPI_HPET_SIGNATURE);
+	if (!hpet || hpet->address.space_id != ACPI_ADR_SPACE_SYSTEM_MEMORY)
+		return ENODEV;
+
+	phys = (addr_t)hpet->address.address;
+	base = (addr_t)vmalloc(PAGE_SIZE);
+	map_page_kernel(base, phys & PAGE_MASK, PROT_WRITE,
+	                PAGE_CP_UNCACHEABLE);
+	hpet_base = (volatile uint32_t *)(base + (phys & ~PAGE_MASK));
+
+	/* the counter period is given in femtoseconds */
+	period = hpet_readl(HPET_REG_PERIOD);
+	if (!period || period > 100000000) {
+		hpet_base = NULL;
+		unmap_page(base);
+		vfree((void *)base);
+		return ENODEV;
+	}
+	hpet_frequency = div_u64(FSEC_PER_SEC + period / 2, period);
+
+	/* disable all comparators before starting the counter */
+	ntimers = HPET_ID_NUM_TIMERS(hpet_readl(HPET_REG_ID));
+	for (i = 0; i < ntimers; ++i) {
+		hpet_writel(HPET_REG_TN_CONFIG(i),
+		            hpet_readl(HPET_REG_TN_CONFIG(i)) &
+		            ~(HPET_TN_ENABLE | HPET_TN_PERIODIC));
+	}
+	hpet_writel(HPET_REG_CONFIG, (hpet_readl(HPET_REG_CONFIG) &
+	            ~HPET_CFG_LEGACY) | HPET_CFG_ENABLE);
+
+	clocksource_config(&clocksource_hpet, hpet_frequency);
+	clocksource_register(&clocksource_hpet);
+
+	if (apic_enabled()) {
+		for (i = 0; i < ntimers; ++i) {
+			if (hpet_nr_timers == HPET_MAX_TIMERS)
+				break;
+			hpet_setup_timer(i);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,32 @@
+/*
+ * arch/i386/cpu/hpet.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARCH_I386_HPET_H
+#define ARCH_I386_HPET_H
+
+#include <radix/types.h>
+
+/* Interrupt vectors used by HPET comparators registered as event devices. */
+#define HPET_INTERRUPT_BASE 0x40
+#define HPET_MAX_TIMERS     4
+
+int hpet_init(void);
+uint32_t hpet_freq(void);
+uint32_t hpet_read_counter(void);
+
+#endif /* ARCH_I386_HPET_H */
@@ -21,6 +21,8 @@
 #include <radix/error.h>
 #include <radix/irq.h>
 #include <radix/kernel.h>
+#include <radix/sched.h>
+#include <radix/softirq.h>
 #include <radix/task.h>
 
 #include "apic.h"
@@ -194,30 +196,49 @@ static int interrupt = 0;
 
 /*
  * interrupt_handler:
- * Common interrupt handler. Saves registers and calls handler
- * for specific interrupt.
+ * Common interrupt handler. Calls the handler for the specific interrupt
+ * with the registers saved on the stack by the entry code.
  */
-void interrupt_handler(struct interrupt_regs ir)
+void interrupt_handler(struct regs *r)
 {
-	struct regs r;
-
 	interrupt = 1;
-	save_registers(&ir, &r);
 
-	if (ir.intno < IRQ_BASE) {
-		if (exception_handlers[ir.intno])
-			exception_handlers[ir.intno](&r, ir.errno);
+	if (r->intno < IRQ_BASE) {
+		if (exception_handlers[r->intno])
+			exception_handlers[r->intno](r, r->errno);
 		else
 			panic("unhandled CPU exception 0x%02X `%s'\n",
-			      ir.intno, exceptions[ir.intno]);
-	} else {
-		/* TODO: send EOI if necessary */
-		if (irq_handlers[ir.intno])
-			irq_handlers[ir.intno](&r);
+			      r->intno, exceptions[r->intno]);
+		interrupt = 0;
+		return;
+	}
+
+	if (irq_handlers[r->intno])
+		irq_handlers[r->intno](r);
+
+	/* spurious APIC interrupts must not be acknowledged */
+	if (apic_enabled()) {
+		if (r->intno != SPURIOUS_INTERRUPT)
+			apic_eoi();
+	} else if (r->intno < IRQ_BASE + 16) {
+		pic_eoi(r->intno - IRQ_BASE);
 	}
 
-	load_registers(&ir, &r);
 	interrupt = 0;
+
+	/* work deferred by the handler runs with interrupts enabled */
+	if (softirq_pending()) {
+		asm volatile("sti");
+		do_softirq();
+		asm volatile("cli");
+	}
+
+	/*
+	 * The interrupt is acknowledged, so it is safe to switch tasks here.
+	 * The interrupted task's registers remain on its stack until it is
+	 * switched back to and returns through interrupt_return.
+	 */
+	preempt_schedule_irq();
 }
 
 int in_interrupt(void)
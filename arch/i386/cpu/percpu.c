@@ -34,7 +34,9 @@ void arch_percpu_init_early(void)
 /*
  * arch_percpu_init:
  * Complete per-CPU initialization by setting the BSP's fsbase to
- * its newly allocated per-CPU section offset.
+ * its newly allocated per-CPU section offset, and switching to the
+ * GDT and TSS within it. After this, the boot copy of the per-CPU
+ * section is no longer used.
  */
 void arch_percpu_init(void)
 {
@@ -43,4 +45,8 @@ void arch_percpu_init(void)
 	offset = __percpu_offset[processor_id()];
 	gdt_set_fsbase(offset);
 	this_cpu_write(__this_cpu_offset, offset);
+
+	/* gdt_init resets the FS segment in the new GDT */
+	gdt_init();
+	gdt_set_fsbase(offset);
 }
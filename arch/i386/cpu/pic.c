@@ -77,6 +77,23 @@ void pic_remap(uint32_t offset1, uint32_t offset2)
 	outb(PIC_SLAVE_DATA,  a2);
 }
 
+/* pic_unmask: allow the PIC to send interrupts for `irq` */
+void pic_unmask(uint32_t irq)
+{
+	uint16_t port;
+
+	if (irq >= 8) {
+		/* slave interrupts are delivered through master IRQ 2 */
+		outb(PIC_MASTER_DATA, inb(PIC_MASTER_DATA) & ~(1 << 2));
+		port = PIC_SLAVE_DATA;
+		irq -= 8;
+	} else {
+		port = PIC_MASTER_DATA;
+	}
+
+	outb(port, inb(port) & ~(1 << irq));
+}
+
 /* pic_disable: prevent the PIC from sending interrupts */
 void pic_disable(void)
 {
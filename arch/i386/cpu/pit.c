@@ -16,49 +16,129 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <radix/asm/regs.h>
+#include <radix/clockevent.h>
+#include <radix/cpu.h>
 #include <radix/io.h>
 #include <radix/irq.h>
-#include <radix/sched.h>
-#include <radix/types.h>
+#include <radix/smp.h>
+#include <radix/tick.h>
 
-#include <rlibc/string.h>
+#include "apic.h"
+#include "isr.h"
+#include "pic.h"
+#include "pit.h"
 
 #define PIT_0   0x40
 #define PIT_1   0x41
 #define PIT_2   0x42
 #define PIT_CMD 0x43
 
+/* channel 0, lobyte/hibyte access */
+#define PIT_CMD_ONESHOT  0x30   /* mode 0: interrupt on terminal count */
+#define PIT_CMD_PERIODIC 0x36   /* mode 3: square wave generator */
+
 #define PIT_OSC_FREQ 1193182
 
-static __always_inline uint16_t pit_divisor(int freq)
+/* Divisor giving the closest frequency to HZ. */
+#define PIT_LATCH    ((PIT_OSC_FREQ + HZ / 2) / HZ)
+
+/* Channel 2 gate control and output status. */
+#define PIT_GATE_PORT   0x61
+#define PIT_GATE2       0x01
+#define PIT_SPEAKER     0x02
+#define PIT_OUT2        0x20
+
+#define PIT_CALIBRATE_LATCH (PIT_OSC_FREQ / (MSEC_PER_SEC / PIT_CALIBRATE_MS))
+
+static void pit_write_count(uint16_t count)
 {
-	return PIT_OSC_FREQ / freq;
+	outb(PIT_0, count & 0xFF);
+	outb(PIT_0, (count >> 8) & 0xFF);
 }
 
-static void pit_start(uint16_t divisor)
+static void pit_set_mode(struct clock_event_device *dev, unsigned int mode)
 {
-	outb(PIT_CMD, 0x36);
-	outb(PIT_0, divisor & 0xFF);
-	outb(PIT_0, (divisor >> 8) & 0xFF);
+	(void)dev;
+
+	switch (mode) {
+	case CLOCK_EVT_MODE_PERIODIC:
+		outb(PIT_CMD, PIT_CMD_PERIODIC);
+		pit_write_count(PIT_LATCH);
+		break;
+	case CLOCK_EVT_MODE_ONESHOT:
+		/* counting starts once set_next_event writes the count */
+		outb(PIT_CMD, PIT_CMD_ONESHOT);
+		break;
+	default:
+		outb(PIT_CMD, PIT_CMD_ONESHOT);
+		pit_write_count(0);
+		break;
+	}
 }
 
+static int pit_next_event(struct clock_event_device *dev,
+                          unsigned long cycles)
+{
+	(void)dev;
+
+	pit_write_count(cycles);
+	return 0;
+}
+
+static struct clock_event_device pit_clockevent = {
+	.name           = "pit",
+	.features       = CLOCK_EVT_FEAT_PERIODIC | CLOCK_EVT_FEAT_ONESHOT,
+	.rating         = 100,
+	.set_mode       = pit_set_mode,
+	.set_next_event = pit_next_event
+};
+
 /*
  * pit_irq0:
  * Timer IRQ handler when PIT is used as system timer.
  */
-void pit_irq0(struct regs *r)
+static void pit_irq0(struct regs *r)
 {
-	memcpy(&(current_task()->regs), r, sizeof *r);
-	schedule(0);
-	memcpy(r, &(current_task()->regs), sizeof *r);
+	if (pit_clockevent.event_handler)
+		pit_clockevent.event_handler(&pit_clockevent, r);
 }
 
+/*
+ * pit_calibrate_start:
+ * Start a countdown of PIT_CALIBRATE_MS milliseconds on PIT channel 2.
+ * Its end is polled by pit_calibrate_wait, allowing the frequencies of
+ * other timers to be measured without relying on interrupts.
+ */
+void pit_calibrate_start(void)
+{
+	/* enable the channel 2 gate, keeping the speaker off */
+	outb(PIT_GATE_PORT, (inb(PIT_GATE_PORT) & ~PIT_SPEAKER) | PIT_GATE2);
+
+	outb(PIT_CMD, 0xB0);
+	outb(PIT_2, PIT_CALIBRATE_LATCH & 0xFF);
+	outb(PIT_2, (PIT_CALIBRATE_LATCH >> 8) & 0xFF);
+}
+
+/* pit_calibrate_wait: wait for the countdown on channel 2 to complete */
+void pit_calibrate_wait(void)
+{
+	while (!(inb(PIT_GATE_PORT) & PIT_OUT2))
+		cpu_relax();
+}
+
+/*
+ * pit_init:
+ * Register the PIT as a clock event device on the bootstrap processor.
+ */
 void pit_init(void)
 {
-	/* Run the PIT at 1000 Hz */
-	const int freq = 1000;
+	install_interrupt_handler(IRQ_BASE + TIMER_IRQ, pit_irq0);
+	if (apic_enabled())
+		ioapic_route_irq(TIMER_IRQ, IRQ_BASE + TIMER_IRQ);
+	else
+		pic_unmask(TIMER_IRQ);
 
-	pit_start(pit_divisor(freq));
-	irq_install(TIMER_IRQ, pit_irq0);
+	clockevents_config(&pit_clockevent, PIT_OSC_FREQ, 0xF, 0xFFFF);
+	pit_clockevent.cpu = processor_id();
+	clockevents_register_device(&pit_clockevent);
 }
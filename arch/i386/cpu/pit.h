@@ -0,0 +1,29 @@
+/*
+ * arch/i386/cpu/pit.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARCH_I386_PIT_H
+#define ARCH_I386_PIT_H
+
+/* Length of the countdown used to calibrate other timers. */
+#define PIT_CALIBRATE_MS 10
+
+void pit_init(void);
+void pit_calibrate_start(void);
+void pit_calibrate_wait(void);
+
+#endif /* ARCH_I386_PIT_H */
@@ -21,60 +21,21 @@
 #include <radix/kthread.h>
 #include <radix/mm_types.h>
 
-#include "gdt.h"
-
-/* save registers from interrupt into r */
-void save_registers(struct interrupt_regs *ir, struct regs *r)
-{
-	r->di = ir->di;
-	r->si = ir->si;
-	r->sp = ir->sp;
-	r->bp = ir->bp;
-	r->bx = ir->bx;
-	r->dx = ir->dx;
-	r->cx = ir->cx;
-	r->ax = ir->ax;
-
-	r->gs = ir->gs;
-	r->fs = ir->fs;
-	r->es = ir->es;
-	r->ds = ir->ds;
-	r->cs = ir->cs;
-	r->ss = ir->ss;
+#include <rlibc/string.h>
 
-	r->ip = ir->ip;
-	r->flags = ir->flags;
-}
-
-/* reload registers from r into interrupt form */
-void load_registers(struct interrupt_regs *ir, struct regs *r)
-{
-	ir->di = r->di;
-	ir->si = r->si;
-	ir->sp = r->sp;
-	ir->bp = r->bp;
-	ir->bx = r->bx;
-	ir->dx = r->dx;
-	ir->cx = r->cx;
-	ir->ax = r->ax;
-
-	ir->gs = r->gs;
-	ir->fs = r->fs;
-	ir->es = r->es;
-	ir->ds = r->ds;
-	ir->cs = r->cs;
-	ir->ss = r->ss;
-
-	ir->ip = r->ip;
-	ir->flags = r->flags;
-}
+#include "gdt.h"
 
 /*
- * Setup stack and registers for a kthread to execute function func
- * with argument arg.
+ * kthread_reg_setup:
+ * Set up the kernel stack ending at `stack` for a kthread to execute
+ * function `func` with argument `arg`. The thread is entered through the
+ * interrupt return path the first time it is switched to.
+ * Return the stack pointer to save in the thread's task struct.
  */
-void kthread_reg_setup(struct regs *r, addr_t stack, addr_t func, addr_t arg)
+addr_t kthread_reg_setup(addr_t stack, addr_t func, addr_t arg)
 {
+	struct switch_frame *sf;
+	struct regs *r;
 	uint32_t *s;
 
 	s = (uint32_t *)stack;
@@ -86,6 +47,8 @@ void kthread_reg_setup(struct regs *r, addr_t stack, addr_t func, addr_t arg)
 	s[-4] = arg;
 	s[-5] = (addr_t)kthread_exit;
 
+	r = (struct regs *)(s - 5) - 1;
+	memset(r, 0, sizeof *r);
 	r->bp = (addr_t)(s - 3);
 	r->sp = (addr_t)(s - 5);
 	r->ip = (addr_t)func;
@@ -98,4 +61,11 @@ void kthread_reg_setup(struct regs *r, addr_t stack, addr_t func, addr_t arg)
 
 	r->cs = GDT_OFFSET(GDT_KERNEL_CODE);
 	r->flags = EFLAGS_IF | EFLAGS_ID;
+
+	/* interrupts stay disabled until the iret */
+	sf = (struct switch_frame *)r - 1;
+	memset(sf, 0, sizeof *sf);
+	sf->ip = (addr_t)interrupt_return;
+
+	return (addr_t)sf;
 }
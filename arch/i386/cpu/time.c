@@ -0,0 +1,38 @@
+/*
+ * arch/i386/cpu/time.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/time.h>
+
+#include "apic.h"
+#include "hpet.h"
+#include "pit.h"
+#include "tsc.h"
+
+/*
+ * x86_time_init:
+ * Set up the system's timer hardware.
+ */
+void x86_time_init(void)
+{
+	pit_init();
+	hpet_init();
+	tsc_init();
+
+	/* per-CPU APIC timers supersede the PIT where available */
+	apic_timer_init();
+}
@@ -0,0 +1,99 @@
+/*
+ * arch/i386/cpu/tsc.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/asm/msr.h>
+#include <radix/clocksource.h>
+#include <radix/cpu.h>
+#include <radix/irq.h>
+#include <radix/math64.h>
+#include <radix/time.h>
+
+#include "hpet.h"
+#include "pit.h"
+#include "tsc.h"
+
+uint32_t tsc_khz;
+
+static uint64_t tsc_read(struct clocksource *cs)
+{
+	(void)cs;
+
+	return rdtsc();
+}
+
+/*
+ * A TSC whose rate varies with the processor's power state is still a
+ * better clock than counting ticks, but is rated below an invariant one
+ * so that any stable alternative is preferred.
+ */
+static struct clocksource clocksource_tsc = {
+	.name   = "tsc",
+	.rating = 100,
+	.read   = tsc_read,
+	.mask   = CLOCKSOURCE_MASK(64)
+};
+
+/*
+ * tsc_calibrate:
+ * Measure the TSC frequency against the HPET if there is one,
+ * or a PIT countdown otherwise.
+ */
+static uint32_t tsc_calibrate(void)
+{
+	uint64_t start, end;
+	uint32_t hpet_start, hpet_cycles;
+	unsigned long flags;
+
+	irq_save(flags);
+	if (hpet_freq()) {
+		hpet_cycles = hpet_freq() / (MSEC_PER_SEC / PIT_CALIBRATE_MS);
+		hpet_start = hpet_read_counter();
+		start = rdtsc();
+		while (hpet_read_counter() - hpet_start < hpet_cycles)
+			cpu_relax();
+		end = rdtsc();
+	} else {
+		pit_calibrate_start();
+		start = rdtsc();
+		pit_calibrate_wait();
+		end = rdtsc();
+	}
+	irq_restore(flags);
+
+	return div_u64(end - start, PIT_CALIBRATE_MS);
+}
+
+/*
+ * tsc_init:
+ * Calibrate the TSC and register it as a clocksource.
+ */
+void tsc_init(void)
+{
+	if (!cpu_supports(CPUID_TSC))
+		return;
+
+	tsc_khz = tsc_calibrate();
+	if (!tsc_khz)
+		return;
+
+	if (cpu_tsc_invariant())
+		clocksource_tsc.rating = 300;
+
+	clocksource_config_khz(&clocksource_tsc, tsc_khz);
+	clocksource_register(&clocksource_tsc);
+}
@@ -25,13 +25,211 @@
 #endif
 
 #include <radix/compiler.h>
+#include <radix/types.h>
 
-#define __arch_atomic_swap x86_atomic_swap
+/*
+ * Without SMP, a single instruction is already atomic with respect to
+ * everything else that can run on the processor.
+ */
+#ifdef CONFIG_SMP
+#define LOCK_PREFIX "lock; "
+#else
+#define LOCK_PREFIX ""
+#endif
+
+/*
+ * x86 only reorders stores with later loads, so read and write barriers
+ * need only prevent compiler reordering. A locked add to the stack is a
+ * full barrier which, unlike mfence, is available on every processor.
+ */
+#define __arch_mb()  asm volatile("lock; addl $0, 0(%%esp)" : : : "memory", "cc")
+#define __arch_rmb() barrier()
+#define __arch_wmb() barrier()
+
+#define __arch_atomic_swap              x86_atomic_swap
+#define __arch_atomic_fetch_add         x86_atomic_fetch_add
+#define __arch_atomic_cmpxchg           x86_atomic_cmpxchg
+#define __arch_atomic_add               x86_atomic_add
+#define __arch_atomic_sub               x86_atomic_sub
+#define __arch_atomic_inc               x86_atomic_inc
+#define __arch_atomic_dec               x86_atomic_dec
+#define __arch_atomic_and               x86_atomic_and
+#define __arch_atomic_or                x86_atomic_or
+#define __arch_atomic_xor               x86_atomic_xor
+#define __arch_atomic_sub_and_test      x86_atomic_sub_and_test
+#define __arch_atomic_dec_and_test      x86_atomic_dec_and_test
+#define __arch_atomic_inc_and_test      x86_atomic_inc_and_test
+#define __arch_atomic_add_negative      x86_atomic_add_negative
+
+#define __arch_atomic64_read            x86_atomic64_read
+#define __arch_atomic64_set             x86_atomic64_set
+#define __arch_atomic64_cmpxchg         x86_atomic64_cmpxchg
+#define __arch_atomic64_xchg            x86_atomic64_xchg
+#define __arch_atomic64_fetch_add       x86_atomic64_fetch_add
 
 static __always_inline int x86_atomic_swap(int *a, int b)
 {
-	asm volatile("xchg %0, %1" : "=r"(b), "=m"(*a) : "0"(b) : "memory");
+	asm volatile("xchg %0, %1" : "=r"(b), "+m"(*a) : "0"(b) : "memory");
 	return b;
 }
 
+/* x86_atomic_fetch_add: add `b` to `*a`, returning the previous value */
+static __always_inline int x86_atomic_fetch_add(int *a, int b)
+{
+	asm volatile(LOCK_PREFIX "xadd %0, %1"
+	             : "=r"(b), "+m"(*a)
+	             : "0"(b)
+	             : "memory");
+	return b;
+}
+
+/*
+ * x86_atomic_cmpxchg:
+ * Set `*a` to `new` if it is equal to `old`.
+ * Return the value of `*a` prior to the operation.
+ */
+static __always_inline int x86_atomic_cmpxchg(int *a, int old, int new)
+{
+	int ret;
+
+	asm volatile(LOCK_PREFIX "cmpxchg %2, %1"
+	             : "=a"(ret), "+m"(*a)
+	             : "r"(new), "0"(old)
+	             : "memory");
+	return ret;
+}
+
+#define __x86_atomic_op(name, op)                                       \
+static __always_inline void x86_atomic_##name(int *a, int b)           \
+{                                                                       \
+	asm volatile(LOCK_PREFIX op " %1, %0"                           \
+	             : "+m"(*a)                                         \
+	             : "ir"(b)                                          \
+	             : "memory");                                       \
+}
+
+__x86_atomic_op(add, "addl")
+__x86_atomic_op(sub, "subl")
+__x86_atomic_op(and, "andl")
+__x86_atomic_op(or, "orl")
+__x86_atomic_op(xor, "xorl")
+
+static __always_inline void x86_atomic_inc(int *a)
+{
+	asm volatile(LOCK_PREFIX "incl %0" : "+m"(*a) : : "memory");
+}
+
+static __always_inline void x86_atomic_dec(int *a)
+{
+	asm volatile(LOCK_PREFIX "decl %0" : "+m"(*a) : : "memory");
+}
+
+/*
+ * x86_atomic_sub_and_test:
+ * Subtract `b` from `*a` and return true if the result is zero.
+ */
+static __always_inline int x86_atomic_sub_and_test(int *a, int b)
+{
+	unsigned char c;
+
+	asm volatile(LOCK_PREFIX "subl %2, %0\n\t"
+	             "sete %1"
+	             : "+m"(*a), "=qm"(c)
+	             : "ir"(b)
+	             : "memory");
+	return c;
+}
+
+static __always_inline int x86_atomic_dec_and_test(int *a)
+{
+	unsigned char c;
+
+	asm volatile(LOCK_PREFIX "decl %0\n\t"
+	             "sete %1"
+	             : "+m"(*a), "=qm"(c)
+	             :
+	             : "memory");
+	return c;
+}
+
+static __always_inline int x86_atomic_inc_and_test(int *a)
+{
+	unsigned char c;
+
+	asm volatile(LOCK_PREFIX "incl %0\n\t"
+	             "sete %1"
+	             : "+m"(*a), "=qm"(c)
+	             :
+	             : "memory");
+	return c;
+}
+
+/* x86_atomic_add_negative: add `b` to `*a`; return true if negative */
+static __always_inline int x86_atomic_add_negative(int *a, int b)
+{
+	unsigned char c;
+
+	asm volatile(LOCK_PREFIX "addl %2, %0\n\t"
+	             "sets %1"
+	             : "+m"(*a), "=qm"(c)
+	             : "ir"(b)
+	             : "memory");
+	return c;
+}
+
+/*
+ * 64-bit operations are all built on cmpxchg8b, as i386 has no other
+ * way to access eight bytes of memory atomically.
+ */
+static __always_inline int64_t x86_atomic64_cmpxchg(int64_t *a, int64_t old,
+                                                    int64_t new)
+{
+	asm volatile(LOCK_PREFIX "cmpxchg8b %1"
+	             : "+A"(old), "+m"(*a)
+	             : "b"((uint32_t)new), "c"((uint32_t)(new >> 32))
+	             : "memory");
+	return old;
+}
+
+/*
+ * x86_atomic64_read:
+ * A cmpxchg8b which compares against an arbitrary value either fails,
+ * loading the current value, or succeeds, storing the value it matched.
+ */
+static __always_inline int64_t x86_atomic64_read(int64_t *a)
+{
+	return x86_atomic64_cmpxchg(a, 0, 0);
+}
+
+static __always_inline int64_t x86_atomic64_xchg(int64_t *a, int64_t b)
+{
+	int64_t old, cur;
+
+	cur = *(volatile int64_t *)a;
+	do {
+		old = cur;
+		cur = x86_atomic64_cmpxchg(a, old, b);
+	} while (cur != old);
+
+	return old;
+}
+
+static __always_inline void x86_atomic64_set(int64_t *a, int64_t b)
+{
+	x86_atomic64_xchg(a, b);
+}
+
+static __always_inline int64_t x86_atomic64_fetch_add(int64_t *a, int64_t b)
+{
+	int64_t old, cur;
+
+	cur = *(volatile int64_t *)a;
+	do {
+		old = cur;
+		cur = x86_atomic64_cmpxchg(a, old, old + b);
+	} while (cur != old);
+
+	return old;
+}
+
 #endif /* ARCH_I386_RADIX_ATOMIC_H */
@@ -0,0 +1,84 @@
+/*
+ * arch/i386/include/radix/asm/bitops.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARCH_I386_RADIX_BITOPS_H
+#define ARCH_I386_RADIX_BITOPS_H
+
+#ifndef RADIX_BITOPS_H
+#error only <radix/bitops.h> can be included directly
+#endif
+
+#include <radix/compiler.h>
+
+/*
+ * The bt* instructions take a bit offset relative to their memory operand
+ * which may extend beyond the addressed long, so they operate directly on
+ * bitmaps of arbitrary size.
+ */
+#define BITOP_ADDR(addr) "+m"(*(volatile long *)(addr))
+
+#define __x86_bitop(name, prefix, op)                                   \
+static __always_inline void name(unsigned int nr, volatile unsigned long *addr)\
+{                                                                       \
+	asm volatile(prefix op " %1, %0"                                \
+	             : BITOP_ADDR(addr)                                 \
+	             : "Ir"(nr)                                         \
+	             : "memory");                                       \
+}
+
+#define __x86_test_bitop(name, prefix, op)                              \
+static __always_inline int name(unsigned int nr, volatile unsigned long *addr) \
+{                                                                       \
+	unsigned char c;                                                \
+									\
+	asm volatile(prefix op " %2, %0\n\t"                            \
+	             "setc %1"                                          \
+	             : BITOP_ADDR(addr), "=qm"(c)                       \
+	             : "Ir"(nr)                                         \
+	             : "memory");                                       \
+	return c;                                                       \
+}
+
+/* Atomic bit operations. */
+__x86_bitop(set_bit, LOCK_PREFIX, "btsl")
+__x86_bitop(clear_bit, LOCK_PREFIX, "btrl")
+__x86_bitop(change_bit, LOCK_PREFIX, "btcl")
+__x86_test_bitop(test_and_set_bit, LOCK_PREFIX, "btsl")
+__x86_test_bitop(test_and_clear_bit, LOCK_PREFIX, "btrl")
+__x86_test_bitop(test_and_change_bit, LOCK_PREFIX, "btcl")
+
+/* Non-atomic versions, for bitmaps protected by some other lock. */
+__x86_bitop(__set_bit, "", "btsl")
+__x86_bitop(__clear_bit, "", "btrl")
+__x86_bitop(__change_bit, "", "btcl")
+__x86_test_bitop(__test_and_set_bit, "", "btsl")
+__x86_test_bitop(__test_and_clear_bit, "", "btrl")
+__x86_test_bitop(__test_and_change_bit, "", "btcl")
+
+#undef __x86_bitop
+#undef __x86_test_bitop
+
+/* __ffs: index of the least significant set bit in `x`, which is nonzero */
+#define __ffs(x) __x86_ffs(x)
+static __always_inline unsigned long __x86_ffs(unsigned long x)
+{
+	asm("bsf %1, %0" : "=r"(x) : "rm"(x));
+	return x;
+}
+
+#endif /* ARCH_I386_RADIX_BITOPS_H */
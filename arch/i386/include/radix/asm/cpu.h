@@ -45,6 +45,12 @@ static __always_inline unsigned long cpuid_supported(void)
 	return res;
 }
 
+/* pause: hint to the processor that this is a spin-wait loop */
+static __always_inline void __arch_cpu_relax(void)
+{
+	asm volatile("pause" : : : "memory");
+}
+
 static __always_inline unsigned long cpu_read_cr2(void)
 {
 	unsigned long ret;
@@ -78,11 +84,14 @@ static __always_inline unsigned long cpu_read_cr2(void)
 #include <radix/types.h>
 
 int cpu_supports(uint64_t features);
+int cpu_tsc_invariant(void);
 
 #define __arch_cache_line_size i386_cache_line_size
 #define __arch_cache_str       i386_cache_str
+#define __arch_possible_cpus   i386_possible_cpus
 
 unsigned long i386_cache_line_size(void);
 char *i386_cache_str(void);
+unsigned int i386_possible_cpus(void);
 
 #endif /* ARCH_I386_RADIX_CPU_H */
@@ -0,0 +1,59 @@
+/*
+ * arch/i386/include/radix/asm/div64.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARCH_I386_RADIX_DIV64_H
+#define ARCH_I386_RADIX_DIV64_H
+
+#ifndef RADIX_MATH64_H
+#error only <radix/math64.h> can be included directly
+#endif
+
+#include <radix/compiler.h>
+#include <radix/types.h>
+
+#define __arch_div64_u32        x86_div64_u32
+
+/*
+ * x86_div64_u32:
+ * Divide `*n` by `base`, storing the quotient in `*n`
+ * and returning the remainder.
+ * The division is done with two 32-bit divl instructions,
+ * avoiding a call to libgcc.
+ */
+static __always_inline uint32_t x86_div64_u32(uint64_t *n, uint32_t base)
+{
+	uint32_t low, high, qhigh, rem;
+
+	low = (uint32_t)*n;
+	high = (uint32_t)(*n >> 32);
+	qhigh = 0;
+
+	if (high >= base) {
+		qhigh = high / base;
+		high %= base;
+	}
+
+	asm("divl %2"
+	    : "=a"(low), "=d"(rem)
+	    : "rm"(base), "0"(low), "1"(high));
+
+	*n = ((uint64_t)qhigh << 32) | low;
+	return rem;
+}
+
+#endif /* ARCH_I386_RADIX_DIV64_H */
@@ -0,0 +1,55 @@
+/*
+ * arch/i386/include/radix/asm/fpu.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARCH_I386_RADIX_FPU_H
+#define ARCH_I386_RADIX_FPU_H
+
+#ifndef RADIX_FPU_H
+#error only <radix/fpu.h> can be included directly
+#endif
+
+#include <radix/compiler.h>
+#include <radix/types.h>
+
+#define FPU_FXSAVE_SIZE 512
+#define FPU_FSAVE_SIZE  108
+
+/*
+ * Saved x87/SSE state of a task. The area is written by fxsave on
+ * processors which support it, and by fnsave otherwise.
+ */
+struct fpu {
+	uint8_t         state[FPU_FXSAVE_SIZE] __aligned(16);
+	int             last_cpu;
+};
+
+#define __arch_fpu_init                 x86_fpu_init
+#define __arch_fpu_switch_out           x86_fpu_switch_out
+#define __arch_fpu_task_exit            x86_fpu_task_exit
+#define __arch_kernel_fpu_begin         x86_kernel_fpu_begin
+#define __arch_kernel_fpu_end           x86_kernel_fpu_end
+
+struct task;
+
+void x86_fpu_init(void);
+void x86_fpu_switch_out(struct task *prev);
+void x86_fpu_task_exit(struct task *task);
+void x86_kernel_fpu_begin(void);
+void x86_kernel_fpu_end(void);
+
+#endif /* ARCH_I386_RADIX_FPU_H */
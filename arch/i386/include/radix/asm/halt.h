@@ -25,6 +25,13 @@
 
 #define HALT() asm volatile("hlt")
 
+/*
+ * Enable interrupts and halt until the next one arrives.
+ * As sti only takes effect after the following instruction,
+ * no interrupt can be taken between the two.
+ */
+#define IDLE_HALT() asm volatile("sti; hlt")
+
 #define DIE()                   \
 do {                            \
 	HALT();                 \
@@ -33,6 +33,8 @@
 #define __arch_irq_active       interrupts_active
 #define __arch_irq_disable()    interrupt_disable()
 #define __arch_irq_enable()     interrupt_enable()
+#define __arch_irq_save         x86_irq_save
+#define __arch_irq_restore      x86_irq_restore
 #define __arch_irq_install      install_interrupt_handler
 #define __arch_irq_uninstall    uninstall_interrupt_handler
 
@@ -84,4 +86,27 @@ static __always_inline int interrupts_active(void)
 	return flags & EFLAGS_IF;
 }
 
+static __always_inline unsigned long x86_irq_save(void)
+{
+	unsigned long flags;
+
+	asm volatile("pushf\n\t"
+	             "pop %0\n\t"
+	             "cli"
+	             : "=rm"(flags)
+	             :
+	             : "memory");
+
+	return flags;
+}
+
+static __always_inline void x86_irq_restore(unsigned long flags)
+{
+	asm volatile("push %0\n\t"
+	             "popf"
+	             :
+	             : "g"(flags)
+	             : "memory", "cc");
+}
+
 #endif /* ARCH_I386_RADIX_IRQ_H */
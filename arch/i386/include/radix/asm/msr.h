@@ -26,6 +26,7 @@
 #define IA32_BIOS_SIGN_ID       0x8B
 #define IA32_MTRRCAP            0xFE
 #define IA32_PAT                0x277
+#define IA32_TSC_DEADLINE       0x6E0
 #define IA32_X2APIC_APICID      0x802
 
 #include <radix/compiler.h>
@@ -41,4 +42,13 @@ static __always_inline void wrmsr(uint32_t msr, uint32_t lo, uint32_t hi)
 	asm volatile("wrmsr" : : "a"(lo), "d"(hi), "c"(msr));
 }
 
+/* rdtsc: read the processor's time-stamp counter */
+static __always_inline uint64_t rdtsc(void)
+{
+	uint32_t lo, hi;
+
+	asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((uint64_t)hi << 32) | lo;
+}
+
 #endif /* ARCH_I386_RADIX_ASM_MSR_H */
@@ -45,6 +45,7 @@
 #define _PAGE_BIT_DIRTY         6
 #define _PAGE_BIT_PAT           7
 #define _PAGE_BIT_GLOBAL        8
+#define _PAGE_BIT_COW           9       /* software: copy on write */
 
 #define PAGE_PRESENT    (((pteval_t)1) << _PAGE_BIT_PRESENT)
 #define PAGE_RW         (((pteval_t)1) << _PAGE_BIT_RW)
@@ -55,6 +56,7 @@
 #define PAGE_DIRTY      (((pteval_t)1) << _PAGE_BIT_DIRTY)
 #define PAGE_PAT        (((pteval_t)1) << _PAGE_BIT_PAT)
 #define PAGE_GLOBAL     (((pteval_t)1) << _PAGE_BIT_GLOBAL)
+#define PAGE_COW        (((pteval_t)1) << _PAGE_BIT_COW)
 
 #include <radix/compiler.h>
 #include <radix/asm/mm_types.h>
@@ -83,6 +85,7 @@ enum cache_policy;
 addr_t i386_virt_to_phys(addr_t addr);
 void i386_set_pde(addr_t virt, pde_t pde);
 int i386_addr_mapped(addr_t virt);
+int i386_addr_cow(addr_t virt);
 int i386_map_page_kernel(addr_t virt, addr_t phys, int prot, int cp);
 int i386_map_page_user(addr_t virt, addr_t phys, int prot, int cp);
 int i386_map_pages(addr_t virt, addr_t phys, int prot,
@@ -112,6 +115,7 @@ static __always_inline addr_t __arch_pa(addr_t v)
 
 #define __arch_set_pde          i386_set_pde
 #define __arch_addr_mapped      i386_addr_mapped
+#define __arch_addr_cow         i386_addr_cow
 #define __arch_map_page_kernel  i386_map_page_kernel
 #define __arch_map_page_user    i386_map_page_user
 #define __arch_map_pages        i386_map_pages
@@ -47,6 +47,57 @@
 #define raw_cpu_write_2(var, val)      __percpu_to_op("movw", var, val)
 #define raw_cpu_write_4(var, val)      __percpu_to_op("movl", var, val)
 
+/*
+ * Read-modify-write operations. Each of these is a single instruction
+ * with a segment override, so it cannot be interrupted between the read
+ * and the write and requires neither disabling interrupts nor a lock prefix.
+ */
+#define this_cpu_add_1(var, val)        __percpu_rmw_op("addb", var, val, "qi")
+#define this_cpu_add_2(var, val)        __percpu_rmw_op("addw", var, val, "ri")
+#define this_cpu_add_4(var, val)        __percpu_rmw_op("addl", var, val, "ri")
+
+#define this_cpu_and_1(var, val)        __percpu_rmw_op("andb", var, val, "qi")
+#define this_cpu_and_2(var, val)        __percpu_rmw_op("andw", var, val, "ri")
+#define this_cpu_and_4(var, val)        __percpu_rmw_op("andl", var, val, "ri")
+
+#define this_cpu_or_1(var, val)         __percpu_rmw_op("orb", var, val, "qi")
+#define this_cpu_or_2(var, val)         __percpu_rmw_op("orw", var, val, "ri")
+#define this_cpu_or_4(var, val)         __percpu_rmw_op("orl", var, val, "ri")
+
+#define this_cpu_xchg_1(var, val)       __percpu_xchg_op("b", var, val, "q")
+#define this_cpu_xchg_2(var, val)       __percpu_xchg_op("w", var, val, "r")
+#define this_cpu_xchg_4(var, val)       __percpu_xchg_op("l", var, val, "r")
+
+#define this_cpu_cmpxchg_1(var, o, n)   __percpu_cmpxchg_op("b", var, o, n, "q")
+#define this_cpu_cmpxchg_2(var, o, n)   __percpu_cmpxchg_op("w", var, o, n, "r")
+#define this_cpu_cmpxchg_4(var, o, n)   __percpu_cmpxchg_op("l", var, o, n, "r")
+
+/* 8-byte operations are built on cmpxchg8b. */
+#define this_cpu_cmpxchg_8(var, o, n)   __percpu_cmpxchg8b_op(var, o, n)
+#define this_cpu_read_8(var)            __percpu_cmpxchg8b_op(var, 0, 0)
+#define this_cpu_write_8(var, val)      ((void)__percpu_xchg8b_op(var, val))
+#define this_cpu_xchg_8(var, val)       __percpu_xchg8b_op(var, val)
+#define this_cpu_add_8(var, val)        __percpu_rmw8b_op(var, val, +)
+#define this_cpu_and_8(var, val)        __percpu_rmw8b_op(var, val, &)
+#define this_cpu_or_8(var, val)         __percpu_rmw8b_op(var, val, |)
+
+#define raw_cpu_add_1(var, val)         this_cpu_add_1(var, val)
+#define raw_cpu_add_2(var, val)         this_cpu_add_2(var, val)
+#define raw_cpu_add_4(var, val)         this_cpu_add_4(var, val)
+#define raw_cpu_and_1(var, val)         this_cpu_and_1(var, val)
+#define raw_cpu_and_2(var, val)         this_cpu_and_2(var, val)
+#define raw_cpu_and_4(var, val)         this_cpu_and_4(var, val)
+#define raw_cpu_or_1(var, val)          this_cpu_or_1(var, val)
+#define raw_cpu_or_2(var, val)          this_cpu_or_2(var, val)
+#define raw_cpu_or_4(var, val)          this_cpu_or_4(var, val)
+#define raw_cpu_xchg_1(var, val)        this_cpu_xchg_1(var, val)
+#define raw_cpu_xchg_2(var, val)        this_cpu_xchg_2(var, val)
+#define raw_cpu_xchg_4(var, val)        this_cpu_xchg_4(var, val)
+#define raw_cpu_cmpxchg_1(var, o, n)    this_cpu_cmpxchg_1(var, o, n)
+#define raw_cpu_cmpxchg_2(var, o, n)    this_cpu_cmpxchg_2(var, o, n)
+#define raw_cpu_cmpxchg_4(var, o, n)    this_cpu_cmpxchg_4(var, o, n)
+#define raw_cpu_cmpxchg_8(var, o, n)    this_cpu_cmpxchg_8(var, o, n)
+
 
 #define __percpu_from_op(op, var)               \
 ({                                              \
@@ -64,6 +115,83 @@ do {                                            \
 	    : "ri"(val));                       \
 } while (0)
 
+#define __percpu_rmw_op(op, var, val, con)      \
+do {                                            \
+	asm volatile(op " %1, " __percpu_arg(0) \
+	             : "+m"(var)                \
+	             : con((typeof(var))(val))  \
+	             : "memory");               \
+} while (0)
+
+/*
+ * A per-CPU exchange does not need to be atomic with respect to other
+ * processors, so an unlocked cmpxchg loop is used instead of xchg, which
+ * would imply a lock prefix.
+ */
+#define __percpu_xchg_op(sz, var, val, con)                             \
+({                                                                      \
+	typeof(var) __pxo_old;                                          \
+	typeof(var) __pxo_new = (val);                                  \
+	asm volatile("mov" sz " " __percpu_arg(1) ", %0\n"              \
+	             "1:\tcmpxchg" sz " %2, " __percpu_arg(1) "\n\t"    \
+	             "jnz 1b"                                           \
+	             : "=&a"(__pxo_old), "+m"(var)                      \
+	             : con(__pxo_new)                                   \
+	             : "memory");                                       \
+	__pxo_old;                                                      \
+})
+
+#define __percpu_cmpxchg_op(sz, var, oval, nval, con)                   \
+({                                                                      \
+	typeof(var) __pco_ret = (oval);                                 \
+	typeof(var) __pco_new = (nval);                                 \
+	asm volatile("cmpxchg" sz " %2, " __percpu_arg(1)               \
+	             : "+a"(__pco_ret), "+m"(var)                       \
+	             : con(__pco_new)                                   \
+	             : "memory");                                       \
+	__pco_ret;                                                      \
+})
+
+/*
+ * The unions allow the 8-byte operations to be instantiated for any type
+ * of per-CPU variable within the size dispatch switch.
+ */
+#define __percpu_cmpxchg8b_op(var, oval, nval)                          \
+({                                                                      \
+	union { typeof(var) v; uint64_t u; } __pc8_ret = { .v = (oval) };\
+	union { typeof(var) v; uint64_t u; } __pc8_new = { .v = (nval) };\
+	asm volatile("cmpxchg8b " __percpu_arg(1)                       \
+	             : "+A"(__pc8_ret.u), "+m"(var)                     \
+	             : "b"((uint32_t)__pc8_new.u),                      \
+	               "c"((uint32_t)(__pc8_new.u >> 32))               \
+	             : "memory");                                       \
+	__pc8_ret.v;                                                    \
+})
+
+#define __percpu_xchg8b_op(var, val)                                    \
+({                                                                      \
+	typeof(var) __px8_old, __px8_cur;                               \
+	typeof(var) __px8_new = (val);                                  \
+	__px8_cur = __percpu_cmpxchg8b_op(var, 0, 0);                   \
+	do {                                                            \
+		__px8_old = __px8_cur;                                  \
+		__px8_cur = __percpu_cmpxchg8b_op(var, __px8_old,       \
+		                                  __px8_new);           \
+	} while (__px8_cur != __px8_old);                               \
+	__px8_old;                                                      \
+})
+
+#define __percpu_rmw8b_op(var, val, op)                                 \
+do {                                                                    \
+	typeof(var) __pr8_old, __pr8_cur;                               \
+	__pr8_cur = __percpu_cmpxchg8b_op(var, 0, 0);                   \
+	do {                                                            \
+		__pr8_old = __pr8_cur;                                  \
+		__pr8_cur = __percpu_cmpxchg8b_op(var, __pr8_old,       \
+		                                  __pr8_old op (val));  \
+	} while (__pr8_cur != __pr8_old);                               \
+} while (0)
+
 #include <radix/percpu_defs.h>
 
 DECLARE_PER_CPU(unsigned long, __this_cpu_offset);
@@ -22,7 +22,12 @@
 #include <radix/types.h>
 #include <radix/mm_types.h>
 
-struct interrupt_regs {
+/*
+ * Register state of an interrupted context, as pushed onto the kernel stack
+ * by the common interrupt entry code in isrvec.S.
+ */
+struct regs {
+	/* gprs */
 	uint32_t di;
 	uint32_t si;
 	uint32_t bp;
@@ -31,6 +36,7 @@ struct interrupt_regs {
 	uint32_t cx;
 	uint32_t ax;
 
+	/* segment registers */
 	uint32_t gs;
 	uint32_t fs;
 	uint32_t es;
@@ -39,6 +45,7 @@ struct interrupt_regs {
 	int32_t intno;
 	int32_t errno;
 
+	/* pushed by the processor */
 	uint32_t ip;
 	uint32_t cs;
 	uint32_t flags;
@@ -46,32 +53,21 @@ struct interrupt_regs {
 	uint32_t ss;
 };
 
-struct regs {
-	/* gprs */
+/*
+ * Callee-saved state of a task which is not running, stored at the top of
+ * its kernel stack by switch_to_task.
+ */
+struct switch_frame {
+	uint32_t flags;
 	uint32_t di;
 	uint32_t si;
-	uint32_t sp;
-	uint32_t bp;
 	uint32_t bx;
-	uint32_t dx;
-	uint32_t cx;
-	uint32_t ax;
-
-	/* segment registers */
-	uint32_t gs;
-	uint32_t fs;
-	uint32_t es;
-	uint32_t ds;
-	uint32_t cs;
-	uint32_t ss;
-
+	uint32_t bp;
 	uint32_t ip;
-	uint32_t flags;
 };
 
-void save_registers(struct interrupt_regs *ir, struct regs *r);
-void load_registers(struct interrupt_regs *ir, struct regs *r);
+void interrupt_return(void);
 
-void kthread_reg_setup(struct regs *r, addr_t stack, addr_t func, addr_t arg);
+addr_t kthread_reg_setup(addr_t stack, addr_t func, addr_t arg);
 
 #endif /* ARCH_I386_RADIX_REGS_H */
@@ -0,0 +1,101 @@
+/*
+ * arch/i386/include/radix/asm/spinlock.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARCH_I386_RADIX_SPINLOCK_H
+#define ARCH_I386_RADIX_SPINLOCK_H
+
+#ifndef RADIX_SPINLOCK_H
+#error only <radix/spinlock.h> can be included directly
+#endif
+
+#include <radix/atomic.h>
+#include <radix/compiler.h>
+#include <radix/cpu.h>
+#include <radix/types.h>
+
+/*
+ * A ticket lock. A locker takes a ticket by atomically incrementing `tail`
+ * and waits until `head`, the ticket currently being served, reaches it.
+ * Waiters are therefore granted the lock in the order in which they arrived.
+ */
+typedef struct {
+	union {
+		uint32_t head_tail;
+		struct {
+			uint16_t head;
+			uint16_t tail;
+		} tickets;
+	};
+} arch_spinlock_t;
+
+#define __ARCH_SPIN_LOCK_UNLOCKED { { 0 } }
+
+#define TICKET_SHIFT 16
+
+#define __arch_spin_lock        x86_spin_lock
+#define __arch_spin_trylock     x86_spin_trylock
+#define __arch_spin_unlock      x86_spin_unlock
+#define __arch_spin_is_locked   x86_spin_is_locked
+
+static __always_inline void x86_spin_lock(arch_spinlock_t *lock)
+{
+	uint32_t inc = 1 << TICKET_SHIFT;
+	uint16_t ticket;
+
+	asm volatile(LOCK_PREFIX "xaddl %0, %1"
+	             : "+r"(inc), "+m"(lock->head_tail)
+	             :
+	             : "memory");
+
+	ticket = inc >> TICKET_SHIFT;
+	while ((uint16_t)inc != ticket) {
+		cpu_relax();
+		inc = READ_ONCE(lock->tickets.head);
+	}
+	barrier();
+}
+
+static __always_inline int x86_spin_trylock(arch_spinlock_t *lock)
+{
+	uint32_t old;
+
+	old = READ_ONCE(lock->head_tail);
+	if ((uint16_t)old != (uint16_t)(old >> TICKET_SHIFT))
+		return 0;
+
+	return x86_atomic_cmpxchg((int *)&lock->head_tail, old,
+	                          old + (1 << TICKET_SHIFT)) == (int)old;
+}
+
+/*
+ * Only the lock holder writes `head`, and stores are not reordered with
+ * earlier loads or stores on x86, so no lock prefix is required.
+ */
+static __always_inline void x86_spin_unlock(arch_spinlock_t *lock)
+{
+	asm volatile("incw %0" : "+m"(lock->tickets.head) : : "memory", "cc");
+}
+
+static __always_inline int x86_spin_is_locked(arch_spinlock_t *lock)
+{
+	uint32_t val = READ_ONCE(lock->head_tail);
+
+	return (uint16_t)val != (uint16_t)(val >> TICKET_SHIFT);
+}
+
+#endif /* ARCH_I386_RADIX_SPINLOCK_H */
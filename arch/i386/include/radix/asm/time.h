@@ -0,0 +1,30 @@
+/*
+ * arch/i386/include/radix/asm/time.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARCH_I386_RADIX_TIME_H
+#define ARCH_I386_RADIX_TIME_H
+
+#ifndef RADIX_TIME_H
+#error only <radix/time.h> can be included directly
+#endif
+
+#define __arch_time_init        x86_time_init
+
+void x86_time_init(void);
+
+#endif /* ARCH_I386_RADIX_TIME_H */
@@ -20,39 +20,110 @@
 #include <radix/irq.h>
 #include <radix/kernel.h>
 #include <radix/mm.h>
+#include <radix/smp.h>
 #include <radix/vmm.h>
 
+#include <rlibc/string.h>
+
 #define X86_PF_PROTECTION  (1 << 0)
 #define X86_PF_WRITE       (1 << 1)
 #define X86_PF_USER        (1 << 2)
 #define X86_PF_RESERVED    (1 << 3)
 #define X86_PF_INSTRUCTION (1 << 4)
 
+/*
+ * Virtual pages through which new physical pages are initialized,
+ * one for each processor.
+ */
+static addr_t fill_windows;
+
+/*
+ * fill_page:
+ * Fill physical page `p` with zeros. The page is accessed through the
+ * executing processor's window so that this can be done without holding
+ * any VMM locks. Interrupts are disabled while the window is in use, so
+ * the task cannot be preempted or migrated away from it.
+ */
+static void fill_page(struct page *p)
+{
+	unsigned long flags;
+	addr_t win;
+
+	irq_save(flags);
+	win = fill_windows + processor_id() * PAGE_SIZE;
+
+	map_page_kernel(win, page_to_phys(p), PROT_WRITE, PAGE_CP_DEFAULT);
+	memset((void *)win, 0, PAGE_SIZE);
+	unmap_page(win);
+
+	irq_restore(flags);
+}
+
 /*
  * do_kernel_pf:
  * Resolve a page fault triggered by a kernel thread.
+ *
+ * Physical pages are allocated and initialized without any VMM locks held.
+ * The faulting area is only locked while it is inspected and while the new
+ * page is added to it, so faults on different areas proceed concurrently.
+ * If another processor resolves the same fault in the meantime, the newly
+ * allocated page is discarded.
  */
 static void do_kernel_pf(addr_t fault_addr, int error)
 {
 	struct vmm_area *area;
 	struct page *p;
 	const char *access;
-	addr_t page;
+	unsigned long irqstate;
+	addr_t page, phys;
+	int cow;
 
 	page = fault_addr & PAGE_MASK;
 	access = error & X86_PF_WRITE ? "write to" : "read from";
 
-	if (error & X86_PF_PROTECTION) {
-		panic("illegal %s virtual address %p\n",
-		      access, fault_addr);
-	}
-
-	area = vmm_get_allocated_area(NULL, fault_addr);
+	area = vmm_area_lock(fault_addr, &irqstate);
 	if (!area) {
+		if (error & X86_PF_PROTECTION) {
+			panic("illegal %s virtual address %p\n",
+			      access, fault_addr);
+		}
 		panic("attempt to %s non-allocated page %p\n",
 		      access, page);
 	}
 
+	if (vmm_addr_is_guard(area, fault_addr)) {
+		panic("kernel stack overflow: %s guard page %p\n",
+		      access, page);
+	}
+
+	phys = 0;
+	cow = 0;
+
+	if (error & X86_PF_PROTECTION) {
+		/*
+		 * Only writes to copy-on-write pages can be resolved.
+		 * The zero page is the only page mapped copy-on-write.
+		 */
+		if (!(error & X86_PF_WRITE) || !addr_cow(page)) {
+			panic("illegal %s virtual address %p\n",
+			      access, fault_addr);
+		}
+
+		phys = virt_to_phys(page);
+		cow = 1;
+	} else if (!(error & X86_PF_WRITE)) {
+		/*
+		 * Reads of untouched pages are backed by the zero page until
+		 * they are first written to, at which point a private page is
+		 * allocated.
+		 */
+		if (addr_mapped(page) || !vmm_map_zero_page(area, page)) {
+			vmm_area_unlock(area, irqstate);
+			return;
+		}
+	}
+	vmm_area_unlock(area, irqstate);
+
 	/*
 	 * XXX: it may be worth investigating a smarter approach to this than
 	 * allocating a single page at a time. For example, the number of pages
@@ -71,9 +142,27 @@ static void do_kernel_pf(addr_t fault_addr, int error)
 		panic("do_kernel_pf: could not allocate physical page\n");
 	}
 
+	if (cow)
+		fill_page(p);
+
+	area = vmm_area_lock(fault_addr, &irqstate);
+	if (!area)
+		panic("page %p freed while resolving fault\n", page);
+
+	if (virt_to_phys(page) != phys) {
+		/* another processor got here first */
+		vmm_area_unlock(area, irqstate);
+		free_pages(p);
+		return;
+	}
+
+	if (cow)
+		vmm_unmap_zero_page(area, page);
+
 	map_page_kernel(page, page_to_phys(p), PROT_WRITE, PAGE_CP_DEFAULT);
 	mark_page_mapped(p, page);
 	vmm_add_area_pages(area, p);
+	vmm_area_unlock(area, irqstate);
 }
 
 static void page_fault(struct regs *r, int error)
@@ -92,5 +181,12 @@ static void page_fault(struct regs *r, int error)
 
 void arch_prepare_pf(void)
 {
+	struct vmm_area *area;
+
+	area = vmm_alloc_size(NULL, MAX_CPUS * PAGE_SIZE, 0);
+	if (IS_ERR(area))
+		panic("failed to allocate page fault windows\n");
+	fill_windows = area->base;
+
 	install_exception_handler(X86_EXCEPTION_PF, page_fault);
 }
@@ -67,6 +67,26 @@ int i386_addr_mapped(addr_t virt)
 		return 0;
 }
 
+/*
+ * i386_addr_cow:
+ * Return 1 if address `virt` is mapped copy-on-write.
+ */
+int i386_addr_cow(addr_t virt)
+{
+	size_t pdi, pti;
+	pte_t *pgtbl;
+
+	pdi = PGDIR_INDEX(virt);
+	pti = PGTBL_INDEX(virt);
+	pgtbl = get_page_table(pdi);
+
+	if (!(PDE(pgdir[pdi]) & PAGE_PRESENT))
+		return 0;
+
+	return (PTE(pgtbl[pti]) & (PAGE_COW | PAGE_PRESENT)) ==
+	       (PAGE_COW | PAGE_PRESENT);
+}
+
 /*
  * cp_to_flags:
  * Convert a cache policy to x86 page flags.
@@ -112,6 +132,8 @@ static int mp_args_to_flags(unsigned long *flags, int prot, int cp)
 
 	if (prot == PROT_WRITE)
 		*flags = PAGE_RW;
+	else if (prot == PROT_COW)
+		*flags = PAGE_COW;
 	else if (prot != PROT_READ)
 		return EINVAL;
 
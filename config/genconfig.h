@@ -0,0 +1,10 @@
+/* genconfig.h for radix kernel; automatically generated */
+
+#ifndef RADIX_GENCONFIG_H
+#define RADIX_GENCONFIG_H
+
+#define CONFIG_MAX_IOAPICS 8
+#define CONFIG_SMP
+#define CONFIG_MAX_CPUS 64
+
+#endif /* RADIX_GENCONFIG_H */
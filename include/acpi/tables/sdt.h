@@ -19,6 +19,7 @@
 #ifndef ACPI_TABLES_SDT_H
 #define ACPI_TABLES_SDT_H
 
+#include <radix/compiler.h>
 #include <radix/types.h>
 
 /* Header of an ACPI System Description Table. */
@@ -34,6 +35,18 @@ struct acpi_sdt_header {
 	uint32_t        creator_revision;
 };
 
+/* Generic Address Structure: location of a register. */
+struct acpi_generic_address {
+	uint8_t         space_id;
+	uint8_t         bit_width;
+	uint8_t         bit_offset;
+	uint8_t         access_width;
+	uint64_t        address;
+} __packed;
+
+#define ACPI_ADR_SPACE_SYSTEM_MEMORY 0
+#define ACPI_ADR_SPACE_SYSTEM_IO     1
+
 struct acpi_subtable_header {
 	uint8_t type;
 	uint8_t length;
@@ -20,7 +20,206 @@
 #define RADIX_ATOMIC_H
 
 #include <radix/asm/atomic.h>
+#include <radix/compiler.h>
+#include <radix/types.h>
 
-#define atomic_swap __arch_atomic_swap
+#define mb()    __arch_mb()
+#define rmb()   __arch_rmb()
+#define wmb()   __arch_wmb()
+
+#ifdef CONFIG_SMP
+#define smp_mb()        mb()
+#define smp_rmb()       rmb()
+#define smp_wmb()       wmb()
+#else
+#define smp_mb()        barrier()
+#define smp_rmb()       barrier()
+#define smp_wmb()       barrier()
+#endif
+
+/* atomic_swap: atomically set `*a` to `b`, returning its old value */
+#define atomic_swap     __arch_atomic_swap
+
+/*
+ * xchg and cmpxchg operate on any word-sized object, such as a pointer.
+ */
+#define xchg(ptr, v)                                                    \
+	((typeof(*(ptr)))__arch_atomic_swap((int *)(ptr), (int)(v)))
+
+#define cmpxchg(ptr, o, n)                                              \
+	((typeof(*(ptr)))__arch_atomic_cmpxchg((int *)(ptr), (int)(o), (int)(n)))
+
+typedef struct {
+	int counter;
+} atomic_t;
+
+typedef struct {
+	int64_t counter;
+} atomic64_t;
+
+#define ATOMIC_INIT(i)   { (i) }
+#define ATOMIC64_INIT(i) { (i) }
+
+static __always_inline int atomic_read(const atomic_t *v)
+{
+	return *(const volatile int *)&v->counter;
+}
+
+static __always_inline void atomic_set(atomic_t *v, int i)
+{
+	*(volatile int *)&v->counter = i;
+}
+
+static __always_inline void atomic_add(atomic_t *v, int i)
+{
+	__arch_atomic_add(&v->counter, i);
+}
+
+static __always_inline void atomic_sub(atomic_t *v, int i)
+{
+	__arch_atomic_sub(&v->counter, i);
+}
+
+static __always_inline void atomic_inc(atomic_t *v)
+{
+	__arch_atomic_inc(&v->counter);
+}
+
+static __always_inline void atomic_dec(atomic_t *v)
+{
+	__arch_atomic_dec(&v->counter);
+}
+
+static __always_inline void atomic_and(atomic_t *v, int i)
+{
+	__arch_atomic_and(&v->counter, i);
+}
+
+static __always_inline void atomic_or(atomic_t *v, int i)
+{
+	__arch_atomic_or(&v->counter, i);
+}
+
+static __always_inline void atomic_xor(atomic_t *v, int i)
+{
+	__arch_atomic_xor(&v->counter, i);
+}
+
+/* atomic_fetch_add: add `i` to `v`, returning its previous value */
+static __always_inline int atomic_fetch_add(atomic_t *v, int i)
+{
+	return __arch_atomic_fetch_add(&v->counter, i);
+}
+
+static __always_inline int atomic_add_return(atomic_t *v, int i)
+{
+	return atomic_fetch_add(v, i) + i;
+}
+
+static __always_inline int atomic_sub_return(atomic_t *v, int i)
+{
+	return atomic_fetch_add(v, -i) - i;
+}
+
+#define atomic_inc_return(v) atomic_add_return(v, 1)
+#define atomic_dec_return(v) atomic_sub_return(v, 1)
+
+static __always_inline int atomic_xchg(atomic_t *v, int i)
+{
+	return __arch_atomic_swap(&v->counter, i);
+}
+
+/*
+ * atomic_cmpxchg:
+ * Set `v` to `new` if it is equal to `old`.
+ * Return the value of `v` prior to the operation.
+ */
+static __always_inline int atomic_cmpxchg(atomic_t *v, int old, int new)
+{
+	return __arch_atomic_cmpxchg(&v->counter, old, new);
+}
+
+static __always_inline int atomic_sub_and_test(atomic_t *v, int i)
+{
+	return __arch_atomic_sub_and_test(&v->counter, i);
+}
+
+static __always_inline int atomic_dec_and_test(atomic_t *v)
+{
+	return __arch_atomic_dec_and_test(&v->counter);
+}
+
+static __always_inline int atomic_inc_and_test(atomic_t *v)
+{
+	return __arch_atomic_inc_and_test(&v->counter);
+}
+
+static __always_inline int atomic_add_negative(atomic_t *v, int i)
+{
+	return __arch_atomic_add_negative(&v->counter, i);
+}
+
+/*
+ * atomic_add_unless:
+ * Add `i` to `v` unless its value is `u`.
+ * Return nonzero if the addition was performed.
+ */
+static __always_inline int atomic_add_unless(atomic_t *v, int i, int u)
+{
+	int c, old;
+
+	c = atomic_read(v);
+	while (c != u) {
+		old = atomic_cmpxchg(v, c, c + i);
+		if (old == c)
+			return 1;
+		c = old;
+	}
+
+	return 0;
+}
+
+#define atomic_inc_not_zero(v) atomic_add_unless(v, 1, 0)
+
+static __always_inline int64_t atomic64_read(atomic64_t *v)
+{
+	return __arch_atomic64_read(&v->counter);
+}
+
+static __always_inline void atomic64_set(atomic64_t *v, int64_t i)
+{
+	__arch_atomic64_set(&v->counter, i);
+}
+
+static __always_inline int64_t atomic64_fetch_add(atomic64_t *v, int64_t i)
+{
+	return __arch_atomic64_fetch_add(&v->counter, i);
+}
+
+static __always_inline int64_t atomic64_add_return(atomic64_t *v, int64_t i)
+{
+	return atomic64_fetch_add(v, i) + i;
+}
+
+static __always_inline int64_t atomic64_sub_return(atomic64_t *v, int64_t i)
+{
+	return atomic64_fetch_add(v, -i) - i;
+}
+
+#define atomic64_add(v, i) ((void)atomic64_fetch_add(v, i))
+#define atomic64_sub(v, i) ((void)atomic64_fetch_add(v, -(i)))
+#define atomic64_inc(v)    atomic64_add(v, 1)
+#define atomic64_dec(v)    atomic64_sub(v, 1)
+
+static __always_inline int64_t atomic64_xchg(atomic64_t *v, int64_t i)
+{
+	return __arch_atomic64_xchg(&v->counter, i);
+}
+
+static __always_inline int64_t atomic64_cmpxchg(atomic64_t *v, int64_t old,
+                                                int64_t new)
+{
+	return __arch_atomic64_cmpxchg(&v->counter, old, new);
+}
 
 #endif /* RADIX_ATOMIC_H */
@@ -0,0 +1,73 @@
+/*
+ * include/radix/bitops.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_BITOPS_H
+#define RADIX_BITOPS_H
+
+#include <radix/atomic.h>
+#include <radix/compiler.h>
+
+#define BITS_PER_LONG (8 * sizeof (unsigned long))
+
+#define BITS_TO_LONGS(n) (((n) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define BIT_WORD(nr)     ((nr) / BITS_PER_LONG)
+#define BIT_MASK(nr)     (1UL << ((nr) % BITS_PER_LONG))
+
+#define DECLARE_BITMAP(name, bits) unsigned long name[BITS_TO_LONGS(bits)]
+
+/*
+ * Bit operations on arrays of unsigned long.
+ *
+ * set_bit, clear_bit, change_bit and their test_and_ forms are atomic.
+ * The versions prefixed with __ are not, and are cheaper to use on bitmaps
+ * which are already protected by a lock.
+ */
+#include <radix/asm/bitops.h>
+
+#ifndef __ffs
+#define __ffs(x) ((unsigned long)__builtin_ctzl(x))
+#endif
+
+/* ffz: index of the least significant zero bit in `x`, which is not ~0 */
+#define ffz(x) __ffs(~(x))
+
+static __always_inline int test_bit(unsigned int nr,
+                                    const volatile unsigned long *addr)
+{
+	return !!(addr[BIT_WORD(nr)] & BIT_MASK(nr));
+}
+
+unsigned long find_next_bit(const unsigned long *addr, unsigned long size,
+                            unsigned long offset);
+unsigned long find_next_zero_bit(const unsigned long *addr, unsigned long size,
+                                 unsigned long offset);
+
+#define find_first_bit(addr, size)      find_next_bit(addr, size, 0)
+#define find_first_zero_bit(addr, size) find_next_zero_bit(addr, size, 0)
+
+#define for_each_set_bit(bit, addr, size)                       \
+	for ((bit) = find_first_bit(addr, size);                \
+	     (bit) < (size);                                    \
+	     (bit) = find_next_bit(addr, size, (bit) + 1))
+
+#define for_each_clear_bit(bit, addr, size)                     \
+	for ((bit) = find_first_zero_bit(addr, size);           \
+	     (bit) < (size);                                    \
+	     (bit) = find_next_zero_bit(addr, size, (bit) + 1))
+
+#endif /* RADIX_BITOPS_H */
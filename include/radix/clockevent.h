@@ -0,0 +1,79 @@
+/*
+ * include/radix/clockevent.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_CLOCKEVENT_H
+#define RADIX_CLOCKEVENT_H
+
+#include <radix/asm/regs.h>
+#include <radix/list.h>
+#include <radix/types.h>
+
+/* Clock event device features */
+#define CLOCK_EVT_FEAT_PERIODIC 0x1
+#define CLOCK_EVT_FEAT_ONESHOT  0x2
+
+/* Clock event device modes */
+#define CLOCK_EVT_MODE_UNUSED   0
+#define CLOCK_EVT_MODE_SHUTDOWN 1
+#define CLOCK_EVT_MODE_PERIODIC 2
+#define CLOCK_EVT_MODE_ONESHOT  3
+
+/*
+ * A clock event device is a programmable timer which raises an interrupt
+ * either periodically or once after a given delay. Intervals are converted
+ * from nanoseconds to device cycles as (ns * mult) >> shift.
+ */
+struct clock_event_device {
+	char            *name;
+	unsigned int    features;
+	unsigned int    mode;
+	int             rating;         /* higher is better */
+	int             cpu;            /* processor the device interrupts */
+
+	uint32_t        mult;
+	uint32_t        shift;
+	uint64_t        min_delta_ns;
+	uint64_t        max_delta_ns;
+	unsigned long   max_delta;      /* in cycles */
+
+	/* set_mode: switch the device to the given CLOCK_EVT_MODE */
+	void            (*set_mode)(struct clock_event_device *dev,
+	                            unsigned int mode);
+	/*
+	 * set_next_event: raise a one-shot interrupt in `cycles` cycles.
+	 * Returns ETIME if that time passed before the device was armed.
+	 */
+	int             (*set_next_event)(struct clock_event_device *dev,
+	                                  unsigned long cycles);
+	/* event_handler: called from the device's interrupt handler */
+	void            (*event_handler)(struct clock_event_device *dev,
+	                                 struct regs *r);
+
+	struct list     list;
+};
+
+void clockevents_config(struct clock_event_device *dev, uint32_t freq,
+                        unsigned long min_delta, unsigned long max_delta);
+void clockevents_config_khz(struct clock_event_device *dev, uint32_t khz,
+                            unsigned long min_delta, unsigned long max_delta);
+void clockevents_register_device(struct clock_event_device *dev);
+void clockevents_set_mode(struct clock_event_device *dev, unsigned int mode);
+int clockevents_program_event(struct clock_event_device *dev,
+                              uint64_t delta_ns);
+
+#endif /* RADIX_CLOCKEVENT_H */
@@ -0,0 +1,49 @@
+/*
+ * include/radix/clocksource.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_CLOCKSOURCE_H
+#define RADIX_CLOCKSOURCE_H
+
+#include <radix/list.h>
+#include <radix/types.h>
+
+#define CLOCKSOURCE_MASK(bits) \
+	((bits) < 64 ? (1ULL << (bits)) - 1 : ~0ULL)
+
+/*
+ * A clocksource is a free-running counter from which the time is read.
+ * Elapsed cycles are converted to nanoseconds as (cycles * mult) >> shift.
+ */
+struct clocksource {
+	char            *name;
+	int             rating;         /* higher is better */
+	uint64_t        (*read)(struct clocksource *cs);
+	uint64_t        mask;           /* counter width */
+	uint32_t        mult;
+	uint32_t        shift;
+	struct list     list;
+};
+
+void clocks_calc_mult_shift(uint32_t *mult, uint32_t *shift,
+                            uint32_t from, uint32_t to, uint32_t maxsec);
+
+void clocksource_config(struct clocksource *cs, uint32_t freq);
+void clocksource_config_khz(struct clocksource *cs, uint32_t khz);
+void clocksource_register(struct clocksource *cs);
+
+#endif /* RADIX_CLOCKSOURCE_H */
@@ -28,6 +28,7 @@
 #define __deprecated __attribute__((deprecated))
 
 #define __aligned(x) __attribute__((aligned(x)))
+#define __packed __attribute__((packed))
 #define __section(x) __attribute__((section(x)))
 
 #define offsetof(type, member) __builtin_offsetof(type, member)
@@ -42,4 +43,8 @@
 
 #define barrier() asm volatile("" : : : "memory")
 
+/* Force a single, non-cached access to `x`. */
+#define READ_ONCE(x)        (*(const volatile typeof(x) *)&(x))
+#define WRITE_ONCE(x, val)  (*(volatile typeof(x) *)&(x) = (val))
+
 #endif /* RADIX_COMPILER_H */
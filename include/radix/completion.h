@@ -0,0 +1,47 @@
+/*
+ * include/radix/completion.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_COMPLETION_H
+#define RADIX_COMPLETION_H
+
+#include <radix/wait.h>
+
+/*
+ * A completion allows tasks to wait for another task to finish some work.
+ * Each call to complete allows a single waiter to proceed; complete_all
+ * releases every current and future waiter until it is reinitialized.
+ */
+struct completion {
+	unsigned int            done;
+	struct wait_queue_head  wait;
+};
+
+#define COMPLETION_INIT(name) { 0, WAIT_QUEUE_HEAD_INIT((name).wait) }
+
+void init_completion(struct completion *x);
+void reinit_completion(struct completion *x);
+
+void wait_for_completion(struct completion *x);
+long wait_for_completion_timeout(struct completion *x, long timeout);
+int try_wait_for_completion(struct completion *x);
+int completion_done(struct completion *x);
+
+void complete(struct completion *x);
+void complete_all(struct completion *x);
+
+#endif /* RADIX_COMPLETION_H */
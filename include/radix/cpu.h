@@ -24,4 +24,9 @@
 #define cpu_cache_line_size __arch_cache_line_size
 #define cpu_cache_str       __arch_cache_str
 
+/* number of processors which may ever be brought online */
+#define possible_cpus       __arch_possible_cpus
+
+#define cpu_relax           __arch_cpu_relax
+
 #endif /* RADIX_CPU_H */
@@ -21,4 +21,42 @@
 
 #define MAX_CPUS 64
 
+#include <radix/bitops.h>
+
+struct cpumask {
+	DECLARE_BITMAP(bits, MAX_CPUS);
+};
+
+static __always_inline void cpumask_setall(struct cpumask *mask)
+{
+	unsigned int i;
+
+	for (i = 0; i < BITS_TO_LONGS(MAX_CPUS); ++i)
+		mask->bits[i] = ~0UL;
+}
+
+static __always_inline void cpumask_clear(struct cpumask *mask)
+{
+	unsigned int i;
+
+	for (i = 0; i < BITS_TO_LONGS(MAX_CPUS); ++i)
+		mask->bits[i] = 0;
+}
+
+#define cpumask_set_cpu(cpu, mask)   set_bit(cpu, (mask)->bits)
+#define cpumask_clear_cpu(cpu, mask) clear_bit(cpu, (mask)->bits)
+#define cpumask_test_cpu(cpu, mask)  test_bit(cpu, (mask)->bits)
+
+#define cpumask_first(mask) find_first_bit((mask)->bits, MAX_CPUS)
+
+#define for_each_cpu(cpu, mask) \
+	for_each_set_bit(cpu, (mask)->bits, MAX_CPUS)
+
+/* processors which are currently running */
+extern struct cpumask __cpu_online_mask;
+#define cpu_online_mask (&__cpu_online_mask)
+
+#define cpu_online(cpu) cpumask_test_cpu(cpu, cpu_online_mask)
+#define for_each_online_cpu(cpu) for_each_cpu(cpu, cpu_online_mask)
+
 #endif /* RADIX_CPUMASK_H */
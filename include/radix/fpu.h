@@ -0,0 +1,42 @@
+/*
+ * include/radix/fpu.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_FPU_H
+#define RADIX_FPU_H
+
+#include <radix/asm/fpu.h>
+
+/*
+ * Floating point and SIMD registers are switched lazily: a task's state
+ * is only loaded when it first uses the FPU after being scheduled, and
+ * only saved if it was loaded. Tasks which never use the FPU have no
+ * state allocated.
+ */
+#define fpu_init                __arch_fpu_init
+#define fpu_switch_out          __arch_fpu_switch_out
+#define fpu_task_exit           __arch_fpu_task_exit
+
+/*
+ * Kernel code must wrap any use of FPU or SIMD registers in a
+ * kernel_fpu_begin/kernel_fpu_end pair. Preemption is disabled within
+ * the section, and it may not be used from interrupt handlers.
+ */
+#define kernel_fpu_begin        __arch_kernel_fpu_begin
+#define kernel_fpu_end          __arch_kernel_fpu_end
+
+#endif /* RADIX_FPU_H */
@@ -0,0 +1,67 @@
+/*
+ * include/radix/hrtimer.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_HRTIMER_H
+#define RADIX_HRTIMER_H
+
+#include <radix/ktime.h>
+#include <radix/rbtree.h>
+
+#define HRTIMER_NORESTART       0
+#define HRTIMER_RESTART         1
+
+struct hrtimer_base;
+
+/*
+ * A high-resolution timer calls `function` from interrupt context once
+ * ktime_get() reaches `expires`. If the function returns HRTIMER_RESTART,
+ * the timer is requeued with its (updated) expiry time.
+ */
+struct hrtimer {
+	struct rb_node          node;
+	ktime_t                 expires;
+	int                     (*function)(struct hrtimer *timer);
+	struct hrtimer_base     *base;
+};
+
+static __always_inline void hrtimer_init(struct hrtimer *timer,
+                                         int (*fn)(struct hrtimer *))
+{
+	rb_init(&timer->node);
+	timer->expires = 0;
+	timer->function = fn;
+	timer->base = NULL;
+}
+
+static __always_inline int hrtimer_active(const struct hrtimer *timer)
+{
+	return READ_ONCE(timer->base) != NULL;
+}
+
+int hrtimer_start(struct hrtimer *timer, ktime_t expires);
+int hrtimer_cancel(struct hrtimer *timer);
+
+/* Expiry time returned by hrtimer_next_expiry when no timer is pending. */
+#define HRTIMER_NONE            (~0ULL)
+
+void hrtimers_init(void);
+void hrtimer_run_queues(uint64_t now);
+uint64_t hrtimer_next_expiry(void);
+int hrtimer_pending(void);
+
+#endif /* RADIX_HRTIMER_H */
@@ -45,6 +45,24 @@ do {                                    \
 	__arch_irq_enable();            \
 } while (0)
 
+/*
+ * irq_save:
+ * Store the current interrupt state in `flags` and disable interrupts.
+ * Unlike irq_disable, this does not nest with irq_disable/irq_enable;
+ * interrupts are only re-enabled by the matching irq_restore.
+ */
+#define irq_save(flags)                 \
+do {                                    \
+	(flags) = __arch_irq_save();    \
+	barrier();                      \
+} while (0)
+
+#define irq_restore(flags)              \
+do {                                    \
+	barrier();                      \
+	__arch_irq_restore(flags);      \
+} while (0)
+
 #define irq_install     __arch_irq_install
 #define irq_uninstall   __arch_irq_uninstall
 
@@ -0,0 +1,42 @@
+/*
+ * include/radix/jiffies.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_JIFFIES_H
+#define RADIX_JIFFIES_H
+
+#include <radix/tick.h>
+#include <radix/types.h>
+
+/* Number of ticks since boot. */
+extern volatile unsigned long jiffies;
+
+uint64_t get_jiffies_64(void);
+
+/* Wraparound-safe comparisons of jiffies values. */
+#define time_after(a, b)        ((long)((b) - (a)) < 0)
+#define time_before(a, b)       time_after(b, a)
+#define time_after_eq(a, b)     ((long)((a) - (b)) >= 0)
+#define time_before_eq(a, b)    time_after_eq(b, a)
+
+#define msecs_to_jiffies(ms) \
+	(((unsigned long)(ms) * HZ + MSEC_PER_SEC - 1) / MSEC_PER_SEC)
+
+#define jiffies_to_msecs(j) \
+	((unsigned long)(j) * (MSEC_PER_SEC / HZ))
+
+#endif /* RADIX_JIFFIES_H */
@@ -21,7 +21,7 @@
 
 #include <radix/task.h>
 
-#define KTHREAD_NAME_LEN 0x40
+#define KTHREAD_NAME_LEN TASK_NAME_LEN
 
 struct task *kthread_create(void (*func)(void *), void *arg,
                             int page_order, char *name, ...);
@@ -0,0 +1,37 @@
+/*
+ * include/radix/ktime.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_KTIME_H
+#define RADIX_KTIME_H
+
+#include <radix/types.h>
+
+/* Nanoseconds since boot. */
+typedef int64_t ktime_t;
+
+#define ktime_to_ns(kt)         ((int64_t)(kt))
+#define ns_to_ktime(ns)         ((ktime_t)(ns))
+#define ktime_add_ns(kt, ns)    ((kt) + (ktime_t)(ns))
+#define ktime_sub(a, b)         ((a) - (b))
+#define ktime_after(a, b)       ((a) > (b))
+#define ktime_before(a, b)      ((a) < (b))
+
+ktime_t ktime_get(void);
+uint64_t ktime_get_ns(void);
+
+#endif /* RADIX_KTIME_H */
@@ -19,6 +19,7 @@
 #ifndef RADIX_LIST_H
 #define RADIX_LIST_H
 
+#include <radix/atomic.h>
 #include <radix/compiler.h>
 
 struct list {
@@ -77,6 +78,43 @@ static __always_inline int list_empty(struct list *head)
 	return head->next == head;
 }
 
+/*
+ * RCU-safe list modification.
+ *
+ * These may run concurrently with readers traversing the list using
+ * list_for_each_entry_rcu within an RCU read-side critical section, but
+ * must be serialized against each other by the caller. An entry removed
+ * with list_del_rcu may still be in use by readers, and cannot be freed
+ * or reused until a grace period has elapsed.
+ */
+static __always_inline void __insert_rcu(struct list *elem, struct list *prev,
+                                         struct list *next)
+{
+	elem->next = next;
+	elem->prev = prev;
+	smp_wmb();
+	WRITE_ONCE(prev->next, elem);
+	next->prev = elem;
+}
+
+static __always_inline void list_add_rcu(struct list *head, struct list *elem)
+{
+	__insert_rcu(elem, head, head->next);
+}
+
+static __always_inline void list_ins_rcu(struct list *head, struct list *elem)
+{
+	__insert_rcu(elem, head->prev, head);
+}
+
+/* Unlike list_del, the removed entry's next pointer is left intact. */
+static __always_inline void list_del_rcu(struct list *elem)
+{
+	WRITE_ONCE(elem->prev->next, elem->next);
+	elem->next->prev = elem->prev;
+	elem->prev = NULL;
+}
+
 #define list_entry(ptr, type, member) \
 	container_of(ptr, type, member)
 
@@ -118,4 +156,11 @@ static __always_inline int list_empty(struct list *head)
 	     &(pos)->member != (head);                                  \
 	     (pos) = list_prev_entry(pos, member))
 
+#define list_for_each_entry_rcu(pos, head, member)                      \
+	for ((pos) = list_entry(READ_ONCE((head)->next),                \
+	                        typeof(*pos), member);                  \
+	     &(pos)->member != (head);                                  \
+	     (pos) = list_entry(READ_ONCE((pos)->member.next),          \
+	                        typeof(*pos), member))
+
 #endif /* RADIX_LIST_H */
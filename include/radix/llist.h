@@ -0,0 +1,95 @@
+/*
+ * include/radix/llist.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_LLIST_H
+#define RADIX_LLIST_H
+
+#include <radix/atomic.h>
+#include <radix/compiler.h>
+#include <radix/types.h>
+
+/*
+ * A lock-free singly linked list. Any number of contexts may add entries
+ * concurrently, while entries are removed all at once by llist_del_all.
+ * Entries are added to the front, so llist_del_all returns them in LIFO
+ * order.
+ */
+struct llist_node {
+	struct llist_node *next;
+};
+
+struct llist_head {
+	struct llist_node *first;
+};
+
+#define LLIST_HEAD_INIT { NULL }
+
+#define llist_entry(ptr, type, member) container_of(ptr, type, member)
+
+static __always_inline void llist_head_init(struct llist_head *head)
+{
+	head->first = NULL;
+}
+
+static __always_inline int llist_empty(const struct llist_head *head)
+{
+	return READ_ONCE(head->first) == NULL;
+}
+
+/*
+ * llist_add:
+ * Add `node` to the front of `head`.
+ * Return 1 if the list was previously empty.
+ */
+static __always_inline int llist_add(struct llist_node *node,
+                                     struct llist_head *head)
+{
+	struct llist_node *first;
+
+	do {
+		first = READ_ONCE(head->first);
+		node->next = first;
+	} while (cmpxchg(&head->first, first, node) != first);
+
+	return first == NULL;
+}
+
+/* llist_del_all: remove and return every entry in `head` */
+static __always_inline struct llist_node *llist_del_all(struct llist_head *head)
+{
+	return xchg(&head->first, NULL);
+}
+
+/* llist_reverse_order: reverse a chain of entries removed from a list */
+static __always_inline struct llist_node *
+llist_reverse_order(struct llist_node *node)
+{
+	struct llist_node *prev, *next;
+
+	prev = NULL;
+	while (node) {
+		next = node->next;
+		node->next = prev;
+		prev = node;
+		node = next;
+	}
+
+	return prev;
+}
+
+#endif /* RADIX_LLIST_H */
@@ -0,0 +1,63 @@
+/*
+ * include/radix/math64.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_MATH64_H
+#define RADIX_MATH64_H
+
+#include <radix/asm/div64.h>
+#include <radix/compiler.h>
+#include <radix/types.h>
+
+/*
+ * div_u64_rem:
+ * Divide 64-bit `n` by 32-bit `base`, storing the remainder in `rem`.
+ */
+static __always_inline uint64_t div_u64_rem(uint64_t n, uint32_t base,
+                                            uint32_t *rem)
+{
+	*rem = __arch_div64_u32(&n, base);
+	return n;
+}
+
+static __always_inline uint64_t div_u64(uint64_t n, uint32_t base)
+{
+	__arch_div64_u32(&n, base);
+	return n;
+}
+
+/*
+ * mul_u64_u32_shr:
+ * Compute (a * mul) >> shift without overflowing the intermediate product.
+ */
+static __always_inline uint64_t mul_u64_u32_shr(uint64_t a, uint32_t mul,
+                                                unsigned int shift)
+{
+	uint32_t low, high;
+	uint64_t ret;
+
+	low = (uint32_t)a;
+	high = (uint32_t)(a >> 32);
+
+	ret = ((uint64_t)low * mul) >> shift;
+	if (high)
+		ret += ((uint64_t)high * mul) << (32 - shift);
+
+	return ret;
+}
+
+#endif /* RADIX_MATH64_H */
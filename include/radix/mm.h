@@ -48,6 +48,7 @@ uint64_t totalmem(void);
 uint64_t usedmem(void);
 
 void buddy_init(struct multiboot_info *mbt);
+void buddy_reclaim(addr_t start, addr_t end);
 
 
 /*
@@ -86,6 +87,12 @@ static __always_inline struct page *alloc_page(unsigned int flags)
 
 extern struct page *page_map;
 
+/*
+ * A single page of zeros which is mapped read-only into demand paged areas
+ * on read faults. It is shared by all such mappings and never freed.
+ */
+extern struct page *zero_page;
+
 #define PFN(x) (virt_to_phys(x) >> PAGE_SHIFT)
 
 static __always_inline struct page *virt_to_page(void *ptr)
@@ -117,9 +124,11 @@ static __always_inline struct page *phys_to_page(addr_t phys)
 
 #define set_pde(virt, pde)              __arch_set_pde(virt, pde)
 #define addr_mapped(virt)               __arch_addr_mapped(virt)
+#define addr_cow(virt)                  __arch_addr_cow(virt)
 
 #define PROT_READ  0
 #define PROT_WRITE 1
+#define PROT_COW   2    /* read-only, copied on first write */
 
 /* CPU caching control */
 enum cache_policy {
@@ -78,6 +78,8 @@ do {                                                    \
 #define PM_SET_PAGE_OFFSET(p, off) \
 	__PM_SET_FIELD(p, off, __OFFSET_MASK, __OFFSET_SHIFT)
 
+#define PM_REFCOUNT_MAX         (__REFCOUNT_MASK >> __REFCOUNT_SHIFT)
+
 #define PM_REFCOUNT_INC(p) \
 	PM_SET_REFCOUNT(p, PM_PAGE_REFCOUNT(p) + 1)
 #define PM_REFCOUNT_DEC(p) \
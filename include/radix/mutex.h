@@ -20,16 +20,29 @@
 #define RADIX_MUTEX_H
 
 #include <radix/list.h>
+#include <radix/spinlock.h>
+#include <radix/types.h>
 
-#define MUTEX_INIT(name) { 0, LIST_INIT((name).queue) }
+#define MUTEX_INIT(name) { 0, SPINLOCK_INIT, LIST_INIT((name).queue) }
 
+/*
+ * `owner` holds the address of the task which has locked the mutex, or 0
+ * if it is unlocked. Its low bit is set while tasks are waiting on `queue`.
+ */
 struct mutex {
-	int             count;
+	addr_t          owner;
+	spinlock_t      wait_lock;
 	struct list     queue;
 };
 
 void mutex_init(struct mutex *m);
 void mutex_lock(struct mutex *m);
+int mutex_trylock(struct mutex *m);
 void mutex_unlock(struct mutex *m);
 
+static __always_inline int mutex_is_locked(struct mutex *m)
+{
+	return READ_ONCE(m->owner) != 0;
+}
+
 #endif /* RADIX_MUTEX_H */
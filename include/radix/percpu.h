@@ -24,4 +24,7 @@
 void percpu_init_early(void);
 void percpu_area_setup(void);
 
+void *alloc_percpu(size_t size, size_t align);
+void free_percpu(void *ptr);
+
 #endif /* RADIX_PERCPU_H */
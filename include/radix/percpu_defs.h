@@ -36,14 +36,14 @@
 
 void this_cpu_bad_size_call(void);
 
-#define __percpu_by_size_ret(stem, var)                                 \
+#define __percpu_by_size_ret(stem, var, ...)                            \
 ({                                                                      \
 	typeof(var) __percpu_ret;                                       \
 	switch (sizeof (var)) {                                         \
-	case 1: __percpu_ret = stem##_1(var); break;                    \
-	case 2: __percpu_ret = stem##_2(var); break;                    \
-	case 4: __percpu_ret = stem##_4(var); break;                    \
-	case 8: __percpu_ret = stem##_8(var); break;                    \
+	case 1: __percpu_ret = stem##_1(var, ##__VA_ARGS__); break;     \
+	case 2: __percpu_ret = stem##_2(var, ##__VA_ARGS__); break;     \
+	case 4: __percpu_ret = stem##_4(var, ##__VA_ARGS__); break;     \
+	case 8: __percpu_ret = stem##_8(var, ##__VA_ARGS__); break;     \
 	default: this_cpu_bad_size_call(); break;                       \
 	}                                                               \
 	__percpu_ret;                                                   \
@@ -64,6 +64,20 @@ do {                                                                    \
 /* Interrupt-safe per-CPU variable operations. */
 #define this_cpu_read(var)       __percpu_by_size_ret(this_cpu_read, var)
 #define this_cpu_write(var, val) __percpu_by_size(this_cpu_write, var, val)
+#define this_cpu_add(var, val)   __percpu_by_size(this_cpu_add, var, val)
+#define this_cpu_sub(var, val)   this_cpu_add(var, -(typeof(var))(val))
+#define this_cpu_inc(var)        this_cpu_add(var, 1)
+#define this_cpu_dec(var)        this_cpu_sub(var, 1)
+#define this_cpu_and(var, val)   __percpu_by_size(this_cpu_and, var, val)
+#define this_cpu_or(var, val)    __percpu_by_size(this_cpu_or, var, val)
+
+/* this_cpu_xchg: set `var` to `val`, returning its old value */
+#define this_cpu_xchg(var, val) \
+	__percpu_by_size_ret(this_cpu_xchg, var, val)
+
+/* this_cpu_cmpxchg: set `var` to `n` if it is `o`; return the old value */
+#define this_cpu_cmpxchg(var, o, n) \
+	__percpu_by_size_ret(this_cpu_cmpxchg, var, o, n)
 
 
 /*
@@ -72,6 +86,16 @@ do {                                                                    \
  */
 #define raw_cpu_read(var)        __percpu_by_size_ret(raw_cpu_read, var)
 #define raw_cpu_write(var, val)  __percpu_by_size(raw_cpu_write, var, val)
+#define raw_cpu_add(var, val)    __percpu_by_size(raw_cpu_add, var, val)
+#define raw_cpu_sub(var, val)    raw_cpu_add(var, -(typeof(var))(val))
+#define raw_cpu_inc(var)         raw_cpu_add(var, 1)
+#define raw_cpu_dec(var)         raw_cpu_sub(var, 1)
+#define raw_cpu_and(var, val)    __percpu_by_size(raw_cpu_and, var, val)
+#define raw_cpu_or(var, val)     __percpu_by_size(raw_cpu_or, var, val)
+#define raw_cpu_xchg(var, val) \
+	__percpu_by_size_ret(raw_cpu_xchg, var, val)
+#define raw_cpu_cmpxchg(var, o, n) \
+	__percpu_by_size_ret(raw_cpu_cmpxchg, var, o, n)
 
 
 #include <radix/cpumask.h>
@@ -92,6 +116,9 @@ extern addr_t __percpu_offset[MAX_CPUS];
 
 #define raw_cpu_ptr(ptr) shift_percpu_ptr(ptr, this_cpu_offset)
 
+/* per_cpu_ptr: get the address of CPU `cpu`'s copy of `ptr` */
+#define per_cpu_ptr(ptr, cpu) shift_percpu_ptr(ptr, __percpu_offset[cpu])
+
 
 #define this_cpu_ptr(ptr)                       \
 ({                                              \
@@ -128,6 +155,48 @@ do {                                            \
 	irq_enable();                           \
 })
 
+#define this_cpu_op_generic(var, val, op)       \
+({                                              \
+	irq_disable();                          \
+	raw_cpu_op_generic(var, val, op);       \
+	irq_enable();                           \
+})
+
+#define raw_cpu_xchg_generic(var, val)          \
+({                                              \
+	typeof(var) *__xg_ptr = raw_cpu_ptr(&(var));    \
+	typeof(var) __xg_ret = *__xg_ptr;       \
+	*__xg_ptr = (val);                      \
+	__xg_ret;                               \
+})
+
+#define raw_cpu_cmpxchg_generic(var, o, n)      \
+({                                              \
+	typeof(var) *__cg_ptr = raw_cpu_ptr(&(var));    \
+	typeof(var) __cg_ret = *__cg_ptr;       \
+	if (__cg_ret == (o))                    \
+		*__cg_ptr = (n);                \
+	__cg_ret;                               \
+})
+
+#define this_cpu_xchg_generic(var, val)         \
+({                                              \
+	typeof(var) __txg_ret;                  \
+	irq_disable();                          \
+	__txg_ret = raw_cpu_xchg_generic(var, val);     \
+	irq_enable();                           \
+	__txg_ret;                              \
+})
+
+#define this_cpu_cmpxchg_generic(var, o, n)     \
+({                                              \
+	typeof(var) __tcg_ret;                  \
+	irq_disable();                          \
+	__tcg_ret = raw_cpu_cmpxchg_generic(var, o, n); \
+	irq_enable();                           \
+	__tcg_ret;                              \
+})
+
 
 #ifndef this_cpu_read_1
 #define this_cpu_read_1(var) this_cpu_read_generic(var)
@@ -182,4 +251,135 @@ do {                                            \
 #define raw_cpu_write_8(var, val) raw_cpu_op_generic(var, val, =)
 #endif
 
+#ifndef this_cpu_add_1
+#define this_cpu_add_1(var, val) this_cpu_op_generic(var, val, +=)
+#endif
+#ifndef this_cpu_add_2
+#define this_cpu_add_2(var, val) this_cpu_op_generic(var, val, +=)
+#endif
+#ifndef this_cpu_add_4
+#define this_cpu_add_4(var, val) this_cpu_op_generic(var, val, +=)
+#endif
+#ifndef this_cpu_add_8
+#define this_cpu_add_8(var, val) this_cpu_op_generic(var, val, +=)
+#endif
+
+#ifndef this_cpu_and_1
+#define this_cpu_and_1(var, val) this_cpu_op_generic(var, val, &=)
+#endif
+#ifndef this_cpu_and_2
+#define this_cpu_and_2(var, val) this_cpu_op_generic(var, val, &=)
+#endif
+#ifndef this_cpu_and_4
+#define this_cpu_and_4(var, val) this_cpu_op_generic(var, val, &=)
+#endif
+#ifndef this_cpu_and_8
+#define this_cpu_and_8(var, val) this_cpu_op_generic(var, val, &=)
+#endif
+
+#ifndef this_cpu_or_1
+#define this_cpu_or_1(var, val) this_cpu_op_generic(var, val, |=)
+#endif
+#ifndef this_cpu_or_2
+#define this_cpu_or_2(var, val) this_cpu_op_generic(var, val, |=)
+#endif
+#ifndef this_cpu_or_4
+#define this_cpu_or_4(var, val) this_cpu_op_generic(var, val, |=)
+#endif
+#ifndef this_cpu_or_8
+#define this_cpu_or_8(var, val) this_cpu_op_generic(var, val, |=)
+#endif
+
+#ifndef this_cpu_xchg_1
+#define this_cpu_xchg_1(var, val) this_cpu_xchg_generic(var, val)
+#endif
+#ifndef this_cpu_xchg_2
+#define this_cpu_xchg_2(var, val) this_cpu_xchg_generic(var, val)
+#endif
+#ifndef this_cpu_xchg_4
+#define this_cpu_xchg_4(var, val) this_cpu_xchg_generic(var, val)
+#endif
+#ifndef this_cpu_xchg_8
+#define this_cpu_xchg_8(var, val) this_cpu_xchg_generic(var, val)
+#endif
+
+#ifndef this_cpu_cmpxchg_1
+#define this_cpu_cmpxchg_1(var, o, n) this_cpu_cmpxchg_generic(var, o, n)
+#endif
+#ifndef this_cpu_cmpxchg_2
+#define this_cpu_cmpxchg_2(var, o, n) this_cpu_cmpxchg_generic(var, o, n)
+#endif
+#ifndef this_cpu_cmpxchg_4
+#define this_cpu_cmpxchg_4(var, o, n) this_cpu_cmpxchg_generic(var, o, n)
+#endif
+#ifndef this_cpu_cmpxchg_8
+#define this_cpu_cmpxchg_8(var, o, n) this_cpu_cmpxchg_generic(var, o, n)
+#endif
+
+
+#ifndef raw_cpu_add_1
+#define raw_cpu_add_1(var, val) raw_cpu_op_generic(var, val, +=)
+#endif
+#ifndef raw_cpu_add_2
+#define raw_cpu_add_2(var, val) raw_cpu_op_generic(var, val, +=)
+#endif
+#ifndef raw_cpu_add_4
+#define raw_cpu_add_4(var, val) raw_cpu_op_generic(var, val, +=)
+#endif
+#ifndef raw_cpu_add_8
+#define raw_cpu_add_8(var, val) raw_cpu_op_generic(var, val, +=)
+#endif
+
+#ifndef raw_cpu_and_1
+#define raw_cpu_and_1(var, val) raw_cpu_op_generic(var, val, &=)
+#endif
+#ifndef raw_cpu_and_2
+#define raw_cpu_and_2(var, val) raw_cpu_op_generic(var, val, &=)
+#endif
+#ifndef raw_cpu_and_4
+#define raw_cpu_and_4(var, val) raw_cpu_op_generic(var, val, &=)
+#endif
+#ifndef raw_cpu_and_8
+#define raw_cpu_and_8(var, val) raw_cpu_op_generic(var, val, &=)
+#endif
+
+#ifndef raw_cpu_or_1
+#define raw_cpu_or_1(var, val) raw_cpu_op_generic(var, val, |=)
+#endif
+#ifndef raw_cpu_or_2
+#define raw_cpu_or_2(var, val) raw_cpu_op_generic(var, val, |=)
+#endif
+#ifndef raw_cpu_or_4
+#define raw_cpu_or_4(var, val) raw_cpu_op_generic(var, val, |=)
+#endif
+#ifndef raw_cpu_or_8
+#define raw_cpu_or_8(var, val) raw_cpu_op_generic(var, val, |=)
+#endif
+
+#ifndef raw_cpu_xchg_1
+#define raw_cpu_xchg_1(var, val) raw_cpu_xchg_generic(var, val)
+#endif
+#ifndef raw_cpu_xchg_2
+#define raw_cpu_xchg_2(var, val) raw_cpu_xchg_generic(var, val)
+#endif
+#ifndef raw_cpu_xchg_4
+#define raw_cpu_xchg_4(var, val) raw_cpu_xchg_generic(var, val)
+#endif
+#ifndef raw_cpu_xchg_8
+#define raw_cpu_xchg_8(var, val) raw_cpu_xchg_generic(var, val)
+#endif
+
+#ifndef raw_cpu_cmpxchg_1
+#define raw_cpu_cmpxchg_1(var, o, n) raw_cpu_cmpxchg_generic(var, o, n)
+#endif
+#ifndef raw_cpu_cmpxchg_2
+#define raw_cpu_cmpxchg_2(var, o, n) raw_cpu_cmpxchg_generic(var, o, n)
+#endif
+#ifndef raw_cpu_cmpxchg_4
+#define raw_cpu_cmpxchg_4(var, o, n) raw_cpu_cmpxchg_generic(var, o, n)
+#endif
+#ifndef raw_cpu_cmpxchg_8
+#define raw_cpu_cmpxchg_8(var, o, n) raw_cpu_cmpxchg_generic(var, o, n)
+#endif
+
 #endif /* RADIX_PERCPU_DEFS_H */
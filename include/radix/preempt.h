@@ -0,0 +1,69 @@
+/*
+ * include/radix/preempt.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_PREEMPT_H
+#define RADIX_PREEMPT_H
+
+#include <radix/compiler.h>
+#include <radix/percpu.h>
+
+/*
+ * While a processor's preempt_count is nonzero, the timer interrupt will
+ * not switch away from the running task.
+ *
+ * The low byte counts preempt_disable calls. The next counts the nesting
+ * of local_bh_disable, and of softirqs being run; while it is nonzero,
+ * softirqs are not run on the processor.
+ */
+DECLARE_PER_CPU(int, preempt_count);
+
+#define SOFTIRQ_SHIFT   8
+#define SOFTIRQ_OFFSET  (1 << SOFTIRQ_SHIFT)
+#define SOFTIRQ_MASK    (0xff << SOFTIRQ_SHIFT)
+
+#define preempt_count() this_cpu_read(preempt_count)
+#define preemptible()   (preempt_count() == 0)
+#define softirq_count() (preempt_count() & SOFTIRQ_MASK)
+#define in_softirq()    (softirq_count() != 0)
+
+#define preempt_disable()               \
+do {                                    \
+	this_cpu_inc(preempt_count);    \
+	barrier();                      \
+} while (0)
+
+#define preempt_enable()                \
+do {                                    \
+	barrier();                      \
+	this_cpu_dec(preempt_count);    \
+} while (0)
+
+/*
+ * local_bh_disable:
+ * Prevent softirqs from running on the executing processor until the
+ * matching local_bh_enable. This also disables preemption.
+ */
+#define local_bh_disable()                              \
+do {                                                    \
+	this_cpu_add(preempt_count, SOFTIRQ_OFFSET);    \
+	barrier();                                      \
+} while (0)
+
+void local_bh_enable(void);
+
+#endif /* RADIX_PREEMPT_H */
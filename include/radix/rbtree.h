@@ -63,4 +63,7 @@ void rb_balance(struct rb_root *root, struct rb_node *node);
 void rb_delete(struct rb_root *root, struct rb_node *node);
 void rb_replace(struct rb_root *root, struct rb_node *old, struct rb_node *new);
 
+struct rb_node *rb_first(struct rb_root *root);
+struct rb_node *rb_next(struct rb_node *node);
+
 #endif /* RADIX_RBTREE_H */
@@ -0,0 +1,69 @@
+/*
+ * include/radix/rcupdate.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_RCUPDATE_H
+#define RADIX_RCUPDATE_H
+
+#include <radix/atomic.h>
+#include <radix/compiler.h>
+#include <radix/percpu.h>
+#include <radix/preempt.h>
+
+/*
+ * Read-copy-update.
+ *
+ * Readers access shared data within rcu_read_lock/rcu_read_unlock, which
+ * take no locks and only disable preemption. Writers publish new data with
+ * rcu_assign_pointer and must not free anything which readers may still
+ * hold until a grace period has elapsed, either by blocking in
+ * synchronize_rcu or by deferring the free with call_rcu.
+ *
+ * As a reader cannot be switched out, a context switch is a quiescent
+ * state for its processor. A grace period ends once every online
+ * processor has passed through one.
+ */
+struct rcu_head {
+	struct rcu_head *next;
+	void            (*func)(struct rcu_head *);
+};
+
+#define rcu_read_lock()         preempt_disable()
+#define rcu_read_unlock()       preempt_enable()
+
+/*
+ * x86 does not reorder dependent loads, so dereferencing an
+ * RCU-protected pointer only requires that it be read exactly once.
+ */
+#define rcu_dereference(p)      READ_ONCE(p)
+
+#define rcu_assign_pointer(p, v)        \
+do {                                    \
+	smp_wmb();                      \
+	WRITE_ONCE(p, v);               \
+} while (0)
+
+DECLARE_PER_CPU(unsigned long, rcu_qs_count);
+
+/* rcu_note_context_switch: report a quiescent state on this processor */
+#define rcu_note_context_switch() this_cpu_inc(rcu_qs_count)
+
+void rcu_init(void);
+void synchronize_rcu(void);
+void call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *));
+
+#endif /* RADIX_RCUPDATE_H */
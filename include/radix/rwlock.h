@@ -0,0 +1,106 @@
+/*
+ * include/radix/rwlock.h
+ * Copyright (C) 2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_RWLOCK_H
+#define RADIX_RWLOCK_H
+
+#include <radix/atomic.h>
+#include <radix/compiler.h>
+#include <radix/cpu.h>
+#include <radix/irq.h>
+#include <radix/preempt.h>
+#include <radix/spinlock.h>
+
+/*
+ * A spinning reader-writer lock.
+ *
+ * `readers` holds the number of active readers. A writer holds `wait` for
+ * the whole of its critical section and waits for existing readers to
+ * drain. New readers briefly take `wait` to register themselves, so they
+ * queue behind a waiting writer and a steady stream of readers cannot
+ * starve it.
+ *
+ * As with spinlocks, the holder cannot be preempted. Locks which are also
+ * taken from interrupt context must be acquired with the irqsave variants.
+ */
+struct rwlock {
+	spinlock_t wait;
+	atomic_t readers;
+};
+
+#define RWLOCK_INIT { SPINLOCK_INIT, ATOMIC_INIT(0) }
+
+static __always_inline void rwlock_init(struct rwlock *lock)
+{
+	spin_init(&lock->wait);
+	atomic_set(&lock->readers, 0);
+}
+
+static __always_inline void read_lock(struct rwlock *lock)
+{
+	preempt_disable();
+	__spin_lock(&lock->wait);
+	atomic_inc(&lock->readers);
+	__spin_unlock(&lock->wait);
+}
+
+static __always_inline void read_unlock(struct rwlock *lock)
+{
+	atomic_dec(&lock->readers);
+	preempt_enable();
+}
+
+static __always_inline void write_lock(struct rwlock *lock)
+{
+	preempt_disable();
+	__spin_lock(&lock->wait);
+	while (atomic_read(&lock->readers))
+		cpu_relax();
+}
+
+static __always_inline void write_unlock(struct rwlock *lock)
+{
+	__spin_unlock(&lock->wait);
+	preempt_enable();
+}
+
+#define read_lock_irqsave(lock, flags)          \
+do {                                            \
+	irq_save(flags);                        \
+	read_lock(lock);                        \
+} while (0)
+
+#define read_unlock_irqrestore(lock, flags)     \
+do {                                            \
+	read_unlock(lock);                      \
+	irq_restore(flags);                     \
+} while (0)
+
+#define write_lock_irqsave(lock, flags)         \
+do {                                            \
+	irq_save(flags);                        \
+	write_lock(lock);                       \
+} while (0)
+
+#define write_unlock_irqrestore(lock, flags)    \
+do {                                            \
+	write_unlock(lock);                     \
+	irq_restore(flags);                     \
+} while (0)
+
+#endif /* RADIX_RWLOCK_H */
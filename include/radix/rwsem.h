@@ -0,0 +1,52 @@
+/*
+ * include/radix/rwsem.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_RWSEM_H
+#define RADIX_RWSEM_H
+
+#include <radix/list.h>
+#include <radix/spinlock.h>
+
+/*
+ * A sleeping reader-writer semaphore.
+ *
+ * `count` is the number of tasks holding the semaphore for reading, or -1
+ * if it is held for writing. Tasks which cannot acquire the semaphore wait
+ * on `wait_list` in FIFO order. Once a writer is waiting, new readers queue
+ * behind it rather than joining the active readers. When a writer releases
+ * the semaphore, every reader at the front of the queue is woken at once.
+ */
+struct rw_semaphore {
+	int             count;
+	spinlock_t      wait_lock;
+	struct list     wait_list;
+};
+
+#define RWSEM_INIT(name) { 0, SPINLOCK_INIT, LIST_INIT((name).wait_list) }
+
+void init_rwsem(struct rw_semaphore *sem);
+
+void down_read(struct rw_semaphore *sem);
+int down_read_trylock(struct rw_semaphore *sem);
+void up_read(struct rw_semaphore *sem);
+
+void down_write(struct rw_semaphore *sem);
+int down_write_trylock(struct rw_semaphore *sem);
+void up_write(struct rw_semaphore *sem);
+
+#endif /* RADIX_RWSEM_H */
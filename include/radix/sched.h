@@ -21,13 +21,38 @@
 
 #include <radix/task.h>
 
+/*
+ * Scheduling policies.
+ * SCHED_NORMAL tasks share the processor in proportion to their priority.
+ * SCHED_PRIO tasks run before any SCHED_NORMAL task, in priority order.
+ */
+#define SCHED_NORMAL            0
+#define SCHED_PRIO              1
+
+/*
+ * Task priorities range from 0 (highest) to SCHED_PRIO_LEVELS - 1 (lowest).
+ */
+#define SCHED_PRIO_LEVELS       32
+#define SCHED_PRIO_DEFAULT      (SCHED_PRIO_LEVELS / 2)
+
+/* Time slices of SCHED_PRIO tasks, in timer ticks. */
+#define SCHED_MIN_TIMESLICE     5
+#define SCHED_TIMESLICE_STEP    5
+
 void schedule(int preempt);
+void preempt_schedule_irq(void);
+__noreturn void cpu_idle(void);
+int sched_tick(unsigned int ticks);
+unsigned int sched_next_tick(void);
 
 void sched_init(void);
 
 void sched_add(struct task *t);
+void sched_set_idle(void);
 void sched_del(struct task *t);
 
-void sched_unblock(struct task *t);
+int sched_setscheduler(struct task *t, int policy, int prio);
+
+int sched_unblock(struct task *t);
 
 #endif /* RADIX_SCHED_H */
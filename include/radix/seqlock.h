@@ -0,0 +1,141 @@
+/*
+ * include/radix/seqlock.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_SEQLOCK_H
+#define RADIX_SEQLOCK_H
+
+#include <radix/atomic.h>
+#include <radix/compiler.h>
+#include <radix/cpu.h>
+#include <radix/spinlock.h>
+
+/*
+ * Sequence counters allow data to be read without taking any lock.
+ *
+ * A writer increments the sequence number before and after modifying the
+ * data, so that it is odd while an update is in progress. A reader records
+ * the sequence number before reading and retries if it has changed:
+ *
+ *	do {
+ *		seq = read_seqbegin(&lock);
+ *		... read data ...
+ *	} while (read_seqretry(&lock, seq));
+ *
+ * Readers never block writers, so data protected this way must be safe to
+ * read while it is being modified, and must not contain pointers which a
+ * writer may free.
+ */
+typedef struct {
+	unsigned int sequence;
+} seqcount_t;
+
+#define SEQCOUNT_INIT { 0 }
+
+static __always_inline void seqcount_init(seqcount_t *s)
+{
+	s->sequence = 0;
+}
+
+static __always_inline unsigned int read_seqcount_begin(const seqcount_t *s)
+{
+	unsigned int ret;
+
+	while ((ret = READ_ONCE(s->sequence)) & 1)
+		cpu_relax();
+
+	smp_rmb();
+	return ret;
+}
+
+/* read_seqcount_retry: return nonzero if a write occurred since `start` */
+static __always_inline int read_seqcount_retry(const seqcount_t *s,
+                                               unsigned int start)
+{
+	smp_rmb();
+	return READ_ONCE(s->sequence) != start;
+}
+
+/*
+ * Writers must be serialized against each other by the caller;
+ * seqlock_t pairs a sequence counter with a spinlock to do so.
+ */
+static __always_inline void write_seqcount_begin(seqcount_t *s)
+{
+	WRITE_ONCE(s->sequence, s->sequence + 1);
+	smp_wmb();
+}
+
+static __always_inline void write_seqcount_end(seqcount_t *s)
+{
+	smp_wmb();
+	WRITE_ONCE(s->sequence, s->sequence + 1);
+}
+
+typedef struct {
+	seqcount_t      seqcount;
+	spinlock_t      lock;
+} seqlock_t;
+
+#define SEQLOCK_INIT { SEQCOUNT_INIT, SPINLOCK_INIT }
+
+static __always_inline void seqlock_init(seqlock_t *sl)
+{
+	seqcount_init(&sl->seqcount);
+	spin_init(&sl->lock);
+}
+
+static __always_inline unsigned int read_seqbegin(const seqlock_t *sl)
+{
+	return read_seqcount_begin(&sl->seqcount);
+}
+
+static __always_inline int read_seqretry(const seqlock_t *sl,
+                                         unsigned int start)
+{
+	return read_seqcount_retry(&sl->seqcount, start);
+}
+
+static __always_inline void write_seqlock(seqlock_t *sl)
+{
+	spin_lock(&sl->lock);
+	write_seqcount_begin(&sl->seqcount);
+}
+
+static __always_inline void write_sequnlock(seqlock_t *sl)
+{
+	write_seqcount_end(&sl->seqcount);
+	spin_unlock(&sl->lock);
+}
+
+/*
+ * Seqlocks written from interrupt context must be written with interrupts
+ * disabled, or a reader interrupted by the writer would spin forever.
+ */
+#define write_seqlock_irqsave(sl, flags)                \
+do {                                                    \
+	spin_lock_irqsave(&(sl)->lock, flags);          \
+	write_seqcount_begin(&(sl)->seqcount);          \
+} while (0)
+
+#define write_sequnlock_irqrestore(sl, flags)           \
+do {                                                    \
+	write_seqcount_end(&(sl)->seqcount);            \
+	spin_unlock_irqrestore(&(sl)->lock, flags);     \
+} while (0)
+
+#endif /* RADIX_SEQLOCK_H */
@@ -0,0 +1,70 @@
+/*
+ * include/radix/softirq.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_SOFTIRQ_H
+#define RADIX_SOFTIRQ_H
+
+#include <radix/llist.h>
+
+/*
+ * Softirqs are work deferred by interrupt handlers, run on the same
+ * processor with interrupts enabled once the handler has returned.
+ * They must not sleep.
+ */
+enum softirq_vec {
+	TASKLET_SOFTIRQ,
+	NR_SOFTIRQS
+};
+
+void open_softirq(unsigned int nr, void (*action)(void));
+void raise_softirq(unsigned int nr);
+int softirq_pending(void);
+void do_softirq(void);
+
+void softirq_init(void);
+
+/*
+ * A tasklet runs function `func` with `data` from a softirq on the
+ * processor which scheduled it. A tasklet is never run on more than one
+ * processor at a time, and scheduling it again before it has started
+ * running has no effect.
+ */
+struct tasklet {
+	struct llist_node       node;
+	unsigned long           state;
+	void                    (*func)(void *data);
+	void                    *data;
+};
+
+#define TASKLET_STATE_SCHED     0
+#define TASKLET_STATE_RUN       1
+
+#define TASKLET_INIT(fn, arg) { { NULL }, 0, fn, arg }
+
+static __always_inline void tasklet_init(struct tasklet *t,
+                                         void (*func)(void *), void *data)
+{
+	t->node.next = NULL;
+	t->state = 0;
+	t->func = func;
+	t->data = data;
+}
+
+void tasklet_schedule(struct tasklet *t);
+
+#endif /* RADIX_SOFTIRQ_H */
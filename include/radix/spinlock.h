@@ -0,0 +1,215 @@
+/*
+ * include/radix/spinlock.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_SPINLOCK_H
+#define RADIX_SPINLOCK_H
+
+#include <radix/atomic.h>
+#include <radix/compiler.h>
+#include <radix/cpu.h>
+#include <radix/irq.h>
+#include <radix/preempt.h>
+
+/*
+ * Spinlocks protect short critical sections. The holder of a spinlock
+ * cannot be preempted and must not sleep. Locks which are also taken
+ * from interrupt handlers must be acquired with spin_lock_irqsave, and
+ * those also taken from softirqs with spin_lock_bh.
+ *
+ * On uniprocessor builds, disabling preemption (and interrupts, for the
+ * irqsave variants) is sufficient, and the lock itself compiles out.
+ */
+#ifdef CONFIG_SMP
+
+#include <radix/asm/spinlock.h>
+
+typedef struct {
+	arch_spinlock_t raw;
+} spinlock_t;
+
+#define SPINLOCK_INIT { __ARCH_SPIN_LOCK_UNLOCKED }
+
+#define __spin_lock(lock)       __arch_spin_lock(&(lock)->raw)
+#define __spin_trylock(lock)    __arch_spin_trylock(&(lock)->raw)
+#define __spin_unlock(lock)     __arch_spin_unlock(&(lock)->raw)
+#define spin_is_locked(lock)    __arch_spin_is_locked(&(lock)->raw)
+
+#else
+
+typedef struct {
+} spinlock_t;
+
+#define SPINLOCK_INIT { }
+
+#define __spin_lock(lock)       ((void)(lock))
+#define __spin_trylock(lock)    ((void)(lock), 1)
+#define __spin_unlock(lock)     ((void)(lock))
+#define spin_is_locked(lock)    ((void)(lock), 0)
+
+#endif /* CONFIG_SMP */
+
+static __always_inline void spin_init(spinlock_t *lock)
+{
+	*lock = (spinlock_t)SPINLOCK_INIT;
+}
+
+static __always_inline void spin_lock(spinlock_t *lock)
+{
+	preempt_disable();
+	__spin_lock(lock);
+}
+
+/* spin_trylock: attempt to acquire `lock` without spinning */
+static __always_inline int spin_trylock(spinlock_t *lock)
+{
+	preempt_disable();
+	if (__spin_trylock(lock))
+		return 1;
+
+	preempt_enable();
+	return 0;
+}
+
+static __always_inline void spin_unlock(spinlock_t *lock)
+{
+	__spin_unlock(lock);
+	preempt_enable();
+}
+
+#define spin_lock_irqsave(lock, flags)          \
+do {                                            \
+	irq_save(flags);                        \
+	spin_lock(lock);                        \
+} while (0)
+
+#define spin_unlock_irqrestore(lock, flags)     \
+do {                                            \
+	spin_unlock(lock);                      \
+	irq_restore(flags);                     \
+} while (0)
+
+/*
+ * spin_lock_bh:
+ * Acquire `lock` with softirqs disabled on the executing processor,
+ * for locks which are also taken from softirqs or tasklets.
+ */
+static __always_inline void spin_lock_bh(spinlock_t *lock)
+{
+	local_bh_disable();
+	spin_lock(lock);
+}
+
+static __always_inline void spin_unlock_bh(spinlock_t *lock)
+{
+	spin_unlock(lock);
+	local_bh_enable();
+}
+
+/*
+ * An MCS queued lock, for heavily contended locks.
+ *
+ * Each waiter spins on the `locked` field of its own mcs_node, which is
+ * passed to both mcs_lock and mcs_unlock and usually lives on the caller's
+ * stack. Releasing the lock writes only to the next waiter's node, so
+ * handing it over does not cause every waiting processor to refetch the
+ * lock's cache line as a ticket lock does.
+ */
+struct mcs_node {
+	struct mcs_node *next;
+	int             locked;
+};
+
+struct mcs_lock {
+	struct mcs_node *tail;
+};
+
+#define MCS_LOCK_INIT { NULL }
+
+#ifdef CONFIG_SMP
+
+static __always_inline void __mcs_lock(struct mcs_lock *lock,
+                                       struct mcs_node *node)
+{
+	struct mcs_node *prev;
+
+	node->next = NULL;
+	node->locked = 0;
+
+	prev = xchg(&lock->tail, node);
+	if (!prev)
+		return;
+
+	WRITE_ONCE(prev->next, node);
+	while (!READ_ONCE(node->locked))
+		cpu_relax();
+	barrier();
+}
+
+static __always_inline void __mcs_unlock(struct mcs_lock *lock,
+                                         struct mcs_node *node)
+{
+	struct mcs_node *next;
+
+	next = READ_ONCE(node->next);
+	if (!next) {
+		if (cmpxchg(&lock->tail, node, NULL) == node)
+			return;
+
+		/* a new waiter is between its xchg and setting our next */
+		while (!(next = READ_ONCE(node->next)))
+			cpu_relax();
+	}
+
+	barrier();
+	WRITE_ONCE(next->locked, 1);
+}
+
+#else
+
+#define __mcs_lock(lock, node)   ((void)(lock), (void)(node))
+#define __mcs_unlock(lock, node) ((void)(lock), (void)(node))
+
+#endif /* CONFIG_SMP */
+
+static __always_inline void mcs_lock(struct mcs_lock *lock,
+                                     struct mcs_node *node)
+{
+	preempt_disable();
+	__mcs_lock(lock, node);
+}
+
+static __always_inline void mcs_unlock(struct mcs_lock *lock,
+                                       struct mcs_node *node)
+{
+	__mcs_unlock(lock, node);
+	preempt_enable();
+}
+
+#define mcs_lock_irqsave(lock, node, flags)     \
+do {                                            \
+	irq_save(flags);                        \
+	mcs_lock(lock, node);                   \
+} while (0)
+
+#define mcs_unlock_irqrestore(lock, node, flags)        \
+do {                                                    \
+	mcs_unlock(lock, node);                         \
+	irq_restore(flags);                             \
+} while (0)
+
+#endif /* RADIX_SPINLOCK_H */
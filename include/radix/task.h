@@ -20,10 +20,17 @@
 #define RADIX_TASK_H
 
 #include <radix/asm/regs.h>
+#include <radix/cpumask.h>
 #include <radix/list.h>
 #include <radix/percpu.h>
+#include <radix/rbtree.h>
+#include <radix/rcupdate.h>
 #include <radix/types.h>
 
+#define TASK_NAME_LEN 0x20
+
+struct fpu;
+struct vmm_area;
 struct vmm_space;
 
 /*
@@ -41,12 +48,23 @@ struct task {
 	uid_t                   uid;
 	gid_t                   gid;
 	mode_t                  umask;
-	struct regs             regs;
+	addr_t                  stack_ptr;
+	int                     on_cpu;
 	struct list             queue;
 	struct vmm_space        *vmm;
-	void                    *stack_base;
-	char                    **cmdline;
+	struct vmm_area         *stack;
+	char                    name[TASK_NAME_LEN];
 	char                    *cwd;
+	int                     cpu;
+	struct cpumask          cpus_allowed;
+	int                     policy;
+	int                     time_slice;
+	uint64_t                vruntime;
+	uint64_t                sum_exec;
+	uint64_t                slice_start;
+	struct rb_node          sched_node;
+	struct fpu              *fpu;
+	struct rcu_head         rcu;
 };
 
 enum task_state {
@@ -23,6 +23,7 @@
 
 void tasking_init(void);
 struct task *kthread_task(void);
+void task_reset(struct task *task);
 void task_free(struct task *task);
 
 void switch_to_task(struct task *task);
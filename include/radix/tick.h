@@ -0,0 +1,34 @@
+/*
+ * include/radix/tick.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_TICK_H
+#define RADIX_TICK_H
+
+#include <radix/time.h>
+
+/* Frequency of the periodic scheduler tick. */
+#define HZ              1000
+#define TICK_NSEC       (NSEC_PER_SEC / HZ)
+
+struct clock_event_device;
+
+int tick_check_new_device(struct clock_event_device *dev);
+void tick_nohz_kick(int cpu);
+void tick_hrtimer_update(void);
+
+#endif /* RADIX_TICK_H */
@@ -0,0 +1,33 @@
+/*
+ * include/radix/time.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_TIME_H
+#define RADIX_TIME_H
+
+#include <radix/asm/time.h>
+
+#define MSEC_PER_SEC    1000UL
+#define USEC_PER_MSEC   1000UL
+#define NSEC_PER_USEC   1000UL
+#define NSEC_PER_MSEC   1000000UL
+#define USEC_PER_SEC    1000000UL
+#define NSEC_PER_SEC    1000000000UL
+
+#define time_init       __arch_time_init
+
+#endif /* RADIX_TIME_H */
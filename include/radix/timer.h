@@ -0,0 +1,71 @@
+/*
+ * include/radix/timer.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_TIMER_H
+#define RADIX_TIMER_H
+
+#include <radix/jiffies.h>
+#include <radix/list.h>
+
+struct timer_base;
+
+/*
+ * A timer calls `function` with `data` from interrupt context once
+ * `jiffies` reaches `expires`.
+ */
+struct timer_list {
+	struct list             entry;
+	unsigned long           expires;
+	void                    (*function)(void *data);
+	void                    *data;
+	struct timer_base       *base;
+};
+
+#define TIMER_INIT(name, fn, arg) \
+	{ LIST_INIT((name).entry), 0, fn, arg, NULL }
+
+static __always_inline void timer_init(struct timer_list *timer,
+                                       void (*fn)(void *), void *data)
+{
+	list_init(&timer->entry);
+	timer->expires = 0;
+	timer->function = fn;
+	timer->data = data;
+	timer->base = NULL;
+}
+
+/* timer_pending: return 1 if `timer` has been added and not yet run */
+static __always_inline int timer_pending(const struct timer_list *timer)
+{
+	return READ_ONCE(timer->base) != NULL;
+}
+
+int timer_add(struct timer_list *timer);
+int timer_del(struct timer_list *timer);
+int timer_mod(struct timer_list *timer, unsigned long expires);
+
+#define MAX_SCHEDULE_TIMEOUT ((long)(~0UL >> 1))
+
+long schedule_timeout(long timeout);
+void msleep(unsigned int msecs);
+
+void timers_init(void);
+void timers_run(void);
+unsigned int timer_next_tick(void);
+
+#endif /* RADIX_TIMER_H */
@@ -51,6 +51,13 @@ void vmm_init(void);
 #define VMM_AREA_MIN_SIZE 64
 
 #define VMM_ALLOC_UPFRONT (1 << 0)
+/*
+ * Reserve an unmapped guard page below the allocated area (e.g. for stacks).
+ * The guard page is included in the returned vmm_area; accessing it is fatal.
+ * When combined with VMM_ALLOC_UPFRONT, the allocation fails outright if the
+ * area cannot be fully populated, as it may not be demand paged.
+ */
+#define VMM_ALLOC_GUARD   (1 << 1)
 
 struct vmm_area *vmm_alloc_size(struct vmm_space *vmm, size_t size,
                                 unsigned long flags);
@@ -60,7 +67,12 @@ void *vmalloc(size_t size);
 void vfree(void *ptr);
 
 struct vmm_area *vmm_get_allocated_area(struct vmm_space *vmm, addr_t addr);
+struct vmm_area *vmm_area_lock(addr_t addr, unsigned long *irqstate);
+void vmm_area_unlock(struct vmm_area *area, unsigned long irqstate);
 void vmm_add_area_pages(struct vmm_area *area, struct page *p);
+int vmm_map_zero_page(struct vmm_area *area, addr_t addr);
+void vmm_unmap_zero_page(struct vmm_area *area, addr_t addr);
+int vmm_addr_is_guard(struct vmm_area *area, addr_t addr);
 
 void arch_prepare_pf(void);
 
@@ -0,0 +1,125 @@
+/*
+ * include/radix/wait.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_WAIT_H
+#define RADIX_WAIT_H
+
+#include <radix/list.h>
+#include <radix/spinlock.h>
+#include <radix/task.h>
+#include <radix/timer.h>
+
+/*
+ * A queue of tasks waiting for some condition to become true.
+ *
+ * Waiters are either non-exclusive, in which case every one of them is
+ * woken when the condition may have changed, or exclusive, in which case
+ * wake_up wakes only the first. Exclusive waiters are queued behind all
+ * non-exclusive ones, so that a single wakeup does not start a herd of
+ * tasks competing for a resource only one of them can take.
+ */
+struct wait_queue_head {
+	spinlock_t      lock;
+	struct list     head;
+};
+
+#define WAIT_QUEUE_HEAD_INIT(name) { SPINLOCK_INIT, LIST_INIT((name).head) }
+
+#define WQ_FLAG_EXCLUSIVE 1
+
+/* A task waiting on a wait queue. Lives on the waiting task's stack. */
+struct wait_queue_entry {
+	struct list     list;
+	struct task     *task;
+	int             flags;
+};
+
+void wait_queue_head_init(struct wait_queue_head *wq);
+void wait_entry_init(struct wait_queue_entry *wait, int flags);
+
+void prepare_to_wait(struct wait_queue_head *wq,
+                     struct wait_queue_entry *wait);
+void finish_wait(struct wait_queue_head *wq, struct wait_queue_entry *wait);
+
+void __wake_up(struct wait_queue_head *wq, int nr_exclusive);
+void wake_up_one(struct wait_queue_head *wq);
+
+/* wake_up: wake every non-exclusive waiter and one exclusive waiter */
+#define wake_up(wq)             __wake_up(wq, 1)
+
+/* wake_up_all: wake every waiter */
+#define wake_up_all(wq)         __wake_up(wq, 0)
+
+#define __wait_event(wq, condition, flags, timeout)                     \
+({                                                                      \
+	struct wait_queue_entry __wait;                                 \
+	long __ret = (timeout);                                         \
+									\
+	wait_entry_init(&__wait, flags);                                \
+	while (1) {                                                     \
+		prepare_to_wait(&(wq), &__wait);                        \
+		if (condition) {                                        \
+			if (!__ret)                                     \
+				__ret = 1;                              \
+			break;                                          \
+		}                                                       \
+		if (!__ret)                                             \
+			break;                                          \
+		__ret = schedule_timeout(__ret);                        \
+	}                                                               \
+	finish_wait(&(wq), &__wait);                                    \
+	__ret;                                                          \
+})
+
+/*
+ * wait_event:
+ * Sleep on `wq` until `condition` evaluates true. It is reevaluated each
+ * time the task is woken.
+ */
+#define wait_event(wq, condition)                                       \
+do {                                                                    \
+	if (!(condition))                                               \
+		__wait_event(wq, condition, 0, MAX_SCHEDULE_TIMEOUT);   \
+} while (0)
+
+/* wait_event_exclusive: as wait_event, but wait as an exclusive waiter */
+#define wait_event_exclusive(wq, condition)                             \
+do {                                                                    \
+	if (!(condition))                                               \
+		__wait_event(wq, condition, WQ_FLAG_EXCLUSIVE,          \
+		             MAX_SCHEDULE_TIMEOUT);                     \
+} while (0)
+
+/*
+ * wait_event_timeout:
+ * Sleep on `wq` until `condition` evaluates true or `timeout` jiffies
+ * elapse. Return 0 if the condition was still false after the timeout,
+ * or the number of jiffies left (at least 1) otherwise.
+ */
+#define wait_event_timeout(wq, condition, timeout)                      \
+({                                                                      \
+	long __tmo = (timeout);                                         \
+									\
+	if (!(condition))                                               \
+		__tmo = __wait_event(wq, condition, 0, __tmo);          \
+	else if (!__tmo)                                                \
+		__tmo = 1;                                              \
+	__tmo;                                                          \
+})
+
+#endif /* RADIX_WAIT_H */
@@ -0,0 +1,54 @@
+/*
+ * include/radix/workqueue.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RADIX_WORKQUEUE_H
+#define RADIX_WORKQUEUE_H
+
+#include <radix/llist.h>
+
+/*
+ * A work item runs `func` in the context of a per-CPU worker thread, so
+ * unlike a tasklet, it may sleep. Queueing a work item which is already
+ * pending has no effect; once it has started running it may be queued
+ * again, including by itself, and may then be run by another worker
+ * before the first run has finished.
+ */
+struct work_struct {
+	struct llist_node       node;
+	unsigned long           pending;
+	void                    (*func)(struct work_struct *work);
+};
+
+#define WORK_STRUCT_PENDING     0
+
+#define WORK_INIT(fn) { { NULL }, 0, fn }
+
+static __always_inline void work_init(struct work_struct *work,
+                                      void (*func)(struct work_struct *))
+{
+	work->node.next = NULL;
+	work->pending = 0;
+	work->func = func;
+}
+
+int schedule_work(struct work_struct *work);
+int schedule_work_on(unsigned int cpu, struct work_struct *work);
+
+void workqueues_init(void);
+
+#endif /* RADIX_WORKQUEUE_H */
@@ -0,0 +1,71 @@
+/*
+ * kernel/bitops.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/bitops.h>
+
+/*
+ * __find_next_bit:
+ * Find the first bit at or after `offset` in the bitmap `addr` of `size`
+ * bits which differs from the bits of `invert`. Return `size` if there
+ * is none.
+ */
+static __always_inline unsigned long __find_next_bit(const unsigned long *addr,
+                                                     unsigned long size,
+                                                     unsigned long offset,
+                                                     unsigned long invert)
+{
+	unsigned long word;
+
+	if (offset >= size)
+		return size;
+
+	word = (addr[BIT_WORD(offset)] ^ invert) & (~0UL << (offset % BITS_PER_LONG));
+	offset -= offset % BITS_PER_LONG;
+
+	while (!word) {
+		offset += BITS_PER_LONG;
+		if (offset >= size)
+			return size;
+		word = addr[BIT_WORD(offset)] ^ invert;
+	}
+
+	offset += __ffs(word);
+	return offset < size ? offset : size;
+}
+
+/*
+ * find_next_bit:
+ * Return the index of the first set bit at or after `offset`
+ * in the bitmap `addr` of `size` bits, or `size` if there is none.
+ */
+unsigned long find_next_bit(const unsigned long *addr, unsigned long size,
+                            unsigned long offset)
+{
+	return __find_next_bit(addr, size, offset, 0);
+}
+
+/*
+ * find_next_zero_bit:
+ * Return the index of the first clear bit at or after `offset`
+ * in the bitmap `addr` of `size` bits, or `size` if there is none.
+ */
+unsigned long find_next_zero_bit(const unsigned long *addr, unsigned long size,
+                                 unsigned long offset)
+{
+	return __find_next_bit(addr, size, offset, ~0UL);
+}
@@ -0,0 +1,115 @@
+/*
+ * kernel/completion.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/completion.h>
+
+/* Value of `done` once complete_all has been called. */
+#define COMPLETION_ALL (~0U >> 1)
+
+void init_completion(struct completion *x)
+{
+	x->done = 0;
+	wait_queue_head_init(&x->wait);
+}
+
+/* reinit_completion: reset `x` so that it can be waited on again */
+void reinit_completion(struct completion *x)
+{
+	WRITE_ONCE(x->done, 0);
+}
+
+/*
+ * try_wait_for_completion:
+ * Consume a completion of `x` without blocking.
+ * Return 1 if one was available.
+ */
+int try_wait_for_completion(struct completion *x)
+{
+	unsigned long flags;
+	int ret;
+
+	if (!READ_ONCE(x->done))
+		return 0;
+
+	spin_lock_irqsave(&x->wait.lock, flags);
+	ret = x->done != 0;
+	if (ret && x->done != COMPLETION_ALL)
+		x->done--;
+	spin_unlock_irqrestore(&x->wait.lock, flags);
+
+	return ret;
+}
+
+/* completion_done: return 1 if a wait on `x` would not block */
+int completion_done(struct completion *x)
+{
+	return READ_ONCE(x->done) != 0;
+}
+
+/* wait_for_completion: sleep until `x` is completed */
+void wait_for_completion(struct completion *x)
+{
+	wait_event_exclusive(x->wait, try_wait_for_completion(x));
+}
+
+/*
+ * wait_for_completion_timeout:
+ * Sleep until `x` is completed or `timeout` jiffies elapse.
+ * Return 0 on timeout, or the number of jiffies left otherwise.
+ */
+long wait_for_completion_timeout(struct completion *x, long timeout)
+{
+	long ret;
+
+	if (try_wait_for_completion(x))
+		return timeout ? timeout : 1;
+
+	ret = __wait_event(x->wait, try_wait_for_completion(x),
+	                   WQ_FLAG_EXCLUSIVE, timeout);
+
+	/* pass on a wakeup which may have been meant for this task */
+	if (!ret && completion_done(x))
+		wake_up(&x->wait);
+
+	return ret;
+}
+
+/* complete: allow a single task waiting on `x` to proceed */
+void complete(struct completion *x)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&x->wait.lock, flags);
+	if (x->done != COMPLETION_ALL)
+		x->done++;
+	spin_unlock_irqrestore(&x->wait.lock, flags);
+
+	wake_up(&x->wait);
+}
+
+/* complete_all: allow every task waiting on `x` to proceed */
+void complete_all(struct completion *x)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&x->wait.lock, flags);
+	x->done = COMPLETION_ALL;
+	spin_unlock_irqrestore(&x->wait.lock, flags);
+
+	wake_up_all(&x->wait);
+}
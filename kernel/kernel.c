@@ -19,13 +19,21 @@
 #include <acpi/acpi.h>
 
 #include <radix/bootmsg.h>
+#include <radix/fpu.h>
+#include <radix/hrtimer.h>
 #include <radix/irq.h>
 #include <radix/kernel.h>
 #include <radix/mm.h>
 #include <radix/multiboot.h>
 #include <radix/percpu.h>
+#include <radix/rcupdate.h>
+#include <radix/sched.h>
+#include <radix/softirq.h>
 #include <radix/tasking.h>
+#include <radix/time.h>
+#include <radix/timer.h>
 #include <radix/vmm.h>
+#include <radix/workqueue.h>
 
 #include "mm/slab.h"
 
@@ -41,13 +49,20 @@ int kmain(struct multiboot_info *mbt)
 	acpi_init();
 	irq_init();
 	percpu_area_setup();
+	fpu_init();
 
 	tasking_init();
+	rcu_init();
+	softirq_init();
+	workqueues_init();
+	timers_init();
+	hrtimers_init();
+	time_init();
 	irq_enable();
 
 	extern void kbd_install(void);
 	kbd_install();
 	printf("\nWelcome to radix\n");
 
-	return 0;
+	cpu_idle();
 }
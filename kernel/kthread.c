@@ -17,12 +17,15 @@
  */
 
 #include <radix/bits.h>
+#include <radix/fpu.h>
 #include <radix/irq.h>
 #include <radix/kthread.h>
 #include <radix/mm.h>
+#include <radix/percpu.h>
 #include <radix/sched.h>
 #include <radix/slab.h>
 #include <radix/tasking.h>
+#include <radix/vmm.h>
 
 #include <rlibc/stdio.h>
 
@@ -30,6 +33,81 @@ static struct task *__kthread_create(void (*func)(void *), void *arg,
                                      int page_order);
 static void kthread_set_name(struct task *thread, char *name, va_list ap);
 
+/*
+ * Kernel stacks are allocated from the kernel's virtual address space with an
+ * unmapped guard page below them, so that an overflow faults immediately
+ * rather than corrupting adjacent memory.
+ *
+ * As setting up and tearing down these mappings is expensive, exited threads
+ * are kept in a small per-CPU pool together with their stacks, and new
+ * threads are created from the pool where possible.
+ */
+#define KTHREAD_POOL_SIZE 8
+
+struct kthread_pool {
+	struct task     *tasks[KTHREAD_POOL_SIZE];
+	int             nr;
+};
+
+static DEFINE_PER_CPU(struct kthread_pool, kthread_pool);
+
+/*
+ * kthread_pool_get:
+ * Take a pooled thread whose stack is `size` bytes (excluding the guard
+ * page) from the current CPU's pool. Return NULL if there is none.
+ */
+static struct task *kthread_pool_get(size_t size)
+{
+	struct kthread_pool *kp;
+	struct task *thread;
+	int i;
+
+	irq_disable();
+	kp = raw_cpu_ptr(&kthread_pool);
+
+	/* most recently exited threads are most likely to be cache-hot */
+	for (i = kp->nr - 1; i >= 0; --i) {
+		thread = kp->tasks[i];
+		if (thread->stack->size == size + PAGE_SIZE) {
+			kp->tasks[i] = kp->tasks[--kp->nr];
+			irq_enable();
+			return thread;
+		}
+	}
+	irq_enable();
+
+	return NULL;
+}
+
+/*
+ * kthread_pool_put:
+ * Release exiting thread `thread` into the current CPU's pool.
+ * As this is called from the exiting thread, which is still running on
+ * its stack, the thread itself is never freed here. Instead, the oldest
+ * pooled thread is evicted when the pool is full.
+ */
+static void kthread_pool_put(struct task *thread)
+{
+	struct kthread_pool *kp;
+	struct task *old;
+	int i;
+
+	irq_disable();
+	kp = raw_cpu_ptr(&kthread_pool);
+
+	if (kp->nr == KTHREAD_POOL_SIZE) {
+		old = kp->tasks[0];
+		for (i = 1; i < KTHREAD_POOL_SIZE; ++i)
+			kp->tasks[i - 1] = kp->tasks[i];
+		--kp->nr;
+		vmm_free(old->stack);
+		task_free(old);
+	}
+	kp->tasks[kp->nr++] = thread;
+
+	irq_enable();
+}
+
 /*
  * kthread_create:
  * Create a kernel thread to run function `func` with argument `arg`,
@@ -90,17 +168,11 @@ void kthread_start(struct task *thread)
 __noreturn void kthread_exit(void)
 {
 	struct task *thread;
-	char **s;
 
 	irq_disable();
 	thread = current_task();
-	free_pages(thread->stack_base);
-
-	for (s = thread->cmdline; *s; ++s)
-		kfree(s);
-	kfree(thread->cmdline);
-
-	task_free(thread);
+	fpu_task_exit(thread);
+	kthread_pool_put(thread);
 	this_cpu_write(current_task, NULL);
 	schedule(1);
 	__builtin_unreachable();
@@ -110,30 +182,36 @@ static struct task *__kthread_create(void (*func)(void *), void *arg,
                                      int page_order)
 {
 	struct task *thread;
-	struct page *p;
+	struct vmm_area *stack;
 	addr_t stack_top;
-
-	thread = kthread_task();
-	if (IS_ERR(thread))
-		return thread;
-
-	p = alloc_pages(PA_STANDARD, page_order);
-	if (IS_ERR(p)) {
-		task_free(thread);
-		return (void *)p;
+	size_t size;
+
+	size = pow2(page_order) * PAGE_SIZE;
+	thread = kthread_pool_get(size);
+	if (thread) {
+		task_reset(thread);
+	} else {
+		thread = kthread_task();
+		if (IS_ERR(thread))
+			return thread;
+
+		stack = vmm_alloc_size(NULL, size,
+		                       VMM_ALLOC_UPFRONT | VMM_ALLOC_GUARD);
+		if (IS_ERR(stack)) {
+			task_free(thread);
+			return (void *)stack;
+		}
+		thread->stack = stack;
 	}
 
-	stack_top = (addr_t)p->mem + pow2(page_order) * PAGE_SIZE;
-	kthread_reg_setup(&thread->regs, stack_top, (addr_t)func, (addr_t)arg);
-	thread->stack_base = p->mem;
+	stack_top = thread->stack->base + thread->stack->size;
+	thread->stack_ptr = kthread_reg_setup(stack_top, (addr_t)func,
+	                                      (addr_t)arg);
 
 	return thread;
 }
 
 static void kthread_set_name(struct task *thread, char *name, va_list ap)
 {
-	thread->cmdline = kmalloc(2 * sizeof *thread->cmdline);
-	thread->cmdline[0] = kmalloc(KTHREAD_NAME_LEN);
-	vsnprintf(thread->cmdline[0], KTHREAD_NAME_LEN, name, ap);
-	thread->cmdline[1] = NULL;
+	vsnprintf(thread->name, sizeof thread->name, name, ap);
 }
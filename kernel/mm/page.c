@@ -28,6 +28,8 @@
 struct page *page_map = (struct page *)PAGE_MAP_BASE;
 addr_t page_map_end = PAGE_MAP_BASE;
 
+struct page *zero_page;
+
 /* First 16 MiB of memory. */
 static struct buddy zone_dma;
 /* Memory for kernel use. */
@@ -112,6 +114,10 @@ void buddy_init(struct multiboot_info *mbt)
 	zone_usr.max_ord = zone_usr.total_pages = zone_usr.alloc_pages = 0;
 
 	buddy_populate();
+
+	zero_page = alloc_page(PA_STANDARD | __PA_ZERO);
+	if (IS_ERR(zero_page))
+		panic("failed to allocate zero page\n");
 }
 
 static struct page *__alloc_pages(struct buddy *zone,
@@ -174,7 +180,7 @@ void free_pages(struct page *p)
 	} else if (p->status & PM_PAGE_ZONE_USR) {
 		zone = &zone_usr;
 		if (p->status & PM_PAGE_MAPPED) {
-			unmap_pages((addr_t)p->mem, ord);
+			unmap_pages((addr_t)p->mem, pow2(ord));
 			p->mem = (void *)PAGE_UNINIT_MAGIC;
 			p->status &= ~PM_PAGE_MAPPED;
 		}
@@ -319,9 +325,19 @@ static struct page *buddy_coalesce(struct buddy *zone, struct page *p)
 /*
  * mark_page_mapped:
  * Indicate that page `p` has been mapped to address `virt`.
+ * If the page is already mapped elsewhere, its reference count is
+ * incremented instead; `virt` is then only an alias of the original
+ * mapping. The count saturates, after which the page is never considered
+ * exclusively owned again.
  */
 void mark_page_mapped(struct page *p, addr_t virt)
 {
+	if (p->status & PM_PAGE_MAPPED) {
+		if (PM_PAGE_REFCOUNT(p) < PM_REFCOUNT_MAX)
+			PM_REFCOUNT_INC(p);
+		return;
+	}
+
 	p->mem = (void *)virt;
 	p->status |= PM_PAGE_MAPPED;
 	PM_SET_REFCOUNT(p, 1);
@@ -476,6 +492,7 @@ static void check_space(size_t pfn, size_t pages)
 
 static size_t zone_init(size_t pfn, size_t section_end,
                         struct buddy *zone, unsigned int flags);
+static void split_block(size_t pfn, size_t lim);
 
 #define M_TO_PAGES(m) (MIB(m) / PAGE_SIZE)
 
@@ -495,6 +512,36 @@ static void buddy_populate(void)
 	pfn = zone_init(pfn, memsize / PAGE_SIZE, &zone_usr, PM_PAGE_ZONE_USR);
 }
 
+/*
+ * buddy_reclaim:
+ * Hand the reserved kernel memory from `start` to `end` (kernel virtual
+ * addresses) over to the page allocator. It must no longer be in use.
+ */
+void buddy_reclaim(addr_t start, addr_t end)
+{
+	size_t pfn, end_pfn, block, i;
+
+	pfn = PFN(ALIGN(start, PAGE_SIZE));
+	end_pfn = PFN(ALIGN(end, PAGE_SIZE));
+	if (pfn >= end_pfn || end_pfn > M_TO_PAGES(4))
+		return;
+
+	/* separate the range from the rest of its reserved block */
+	block = pfn - PM_PAGE_BLOCK_OFFSET(page_map + pfn);
+	while (block + pow2(PM_PAGE_BLOCK_ORDER(page_map + block)) <= pfn)
+		block += pow2(PM_PAGE_BLOCK_ORDER(page_map + block));
+	if (block != pfn)
+		split_block(block, pfn);
+
+	for (i = pfn; i < end_pfn; ++i) {
+		if (!(page_map[i].status & PM_PAGE_INVALID))
+			memused -= PAGE_SIZE;
+		page_map[i].status &= ~(PM_PAGE_MAPPED | PM_PAGE_RESERVED);
+	}
+
+	zone_init(pfn, end_pfn, &zone_dma, 0);
+}
+
 /*
  * split_block:
  * Split block of pages starting at `pfn` into two blocks around PFN `lim`.
@@ -22,6 +22,8 @@
 #include <radix/cpu.h>
 #include <radix/kernel.h>
 #include <radix/mm.h>
+#include <radix/rcupdate.h>
+#include <radix/rwsem.h>
 #include <radix/slab.h>
 
 #include <rlibc/stdio.h>
@@ -30,6 +32,7 @@
 #include "slab.h"
 
 struct list slab_caches;
+static struct rw_semaphore slab_caches_sem = RWSEM_INIT(slab_caches_sem);
 
 /* The cache cache caches caches. */
 static struct slab_cache cache_cache;
@@ -92,7 +95,9 @@ struct slab_cache *create_cache(const char *name, size_t size,
 	}
 
 	__init_cache(cache, name, size, align, flags, ctor, dtor);
-	list_ins(&slab_caches, &cache->list);
+	down_write(&slab_caches_sem);
+	list_ins_rcu(&slab_caches, &cache->list);
+	up_write(&slab_caches_sem);
 
 	return cache;
 }
@@ -105,6 +110,13 @@ void destroy_cache(struct slab_cache *cache)
 {
 	struct list *l, *tmp;
 
+	down_write(&slab_caches_sem);
+	list_del_rcu(&cache->list);
+	up_write(&slab_caches_sem);
+
+	/* lockless walkers of slab_caches may still be looking at the cache */
+	synchronize_rcu();
+
 	list_for_each_safe(l, tmp, &cache->full_slabs) {
 		destroy_slab(cache, list_entry(l, struct slab_desc, list));
 		list_del(l);
@@ -118,7 +130,6 @@ void destroy_cache(struct slab_cache *cache)
 		list_del(l);
 	}
 
-	list_del(&cache->list);
 	free_cache(&cache_cache, cache);
 }
 
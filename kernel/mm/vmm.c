@@ -19,6 +19,7 @@
 #include <radix/bits.h>
 #include <radix/kernel.h>
 #include <radix/mm.h>
+#include <radix/rwlock.h>
 #include <radix/slab.h>
 #include <radix/vmm.h>
 
@@ -30,9 +31,17 @@ struct vmm_block {
 	struct page             *mapped;
 	struct vmm_space        *vmm;
 	unsigned long           flags;
-	unsigned long           padding;
+	unsigned long           zero_pages;     /* mappings of zero page */
+	spinlock_t              page_lock;
 	struct list             global_list;
-	struct rb_node          size_node;
+	union {
+		struct rb_node  size_node;
+		struct {
+			uint32_t        free_map[2];
+			uint16_t        obj_shift;
+			uint16_t        nr_free;
+		} small;
+	};
 	struct rb_node          addr_node;
 };
 
@@ -60,9 +69,42 @@ struct vmm_block {
  * 5. mapped is either NULL or a pointer to a struct page representing a group
  *    of physical pages allocated for this vmm_block. The struct page's list
  *    stores all of the other physical page groups allocated for this block.
+ *
+ * An allocated vmm_block can also be a single page used by the small object
+ * allocator (VMM_SMALL). In that case, area.list is in the list of pages with
+ * free objects of the block's size class (or empty if the page is full), and
+ * the `small` fields replace size_node.
+ *
+ * Locking (kernel address space only):
+ * vmm_kernel_lock protects all of the trees and lists above, as well as the
+ * base, size and allocation state of every block. It is held for writing
+ * while blocks are allocated, freed, split or coalesced. Looking up an
+ * allocated block only requires it to be held for reading, which allows page
+ * faults on existing areas to be handled concurrently.
+ * The physical pages of an allocated block (`mapped`) are protected by the
+ * block's `page_lock`, which is only taken with vmm_kernel_lock held for
+ * reading. The object bitmaps of small object pages and their size class
+ * lists are protected by holding vmm_kernel_lock for writing.
+ * As vmm_kernel_lock is taken while resolving page faults, which may occur
+ * with interrupts disabled, it is always acquired with interrupts saved.
  */
 
 #define VMM_ALLOCATED (1 << 0)
+#define VMM_GUARD     (1 << 1)   /* lowest page of block is a guard page */
+#define VMM_SMALL     (1 << 3)   /* page used by small object allocator */
+
+/*
+ * vmalloc requests of up to half a page are served by splitting pages into
+ * objects of a power of two size class, from VMM_AREA_MIN_SIZE to
+ * PAGE_SIZE / 2. Each page is a single vmm_block with a bitmap of its free
+ * objects, so individual objects require no metadata of their own.
+ */
+#define VMM_SMALL_MIN_SHIFT     6
+#define VMM_SMALL_MAX_SHIFT     (PAGE_SHIFT - 1)
+#define VMM_SMALL_CLASSES       (VMM_SMALL_MAX_SHIFT - VMM_SMALL_MIN_SHIFT + 1)
+
+/* pages with free objects, by size class */
+static struct list vmm_small_pages[VMM_SMALL_CLASSES];
 
 #define vmm_block_alloc()       alloc_cache(vmm_block_cache)
 #define vmm_block_free(block)   free_cache(vmm_block_cache, block)
@@ -70,6 +112,8 @@ struct vmm_block {
 static struct slab_cache *vmm_block_cache;
 static struct slab_cache *vmm_space_cache;
 
+static struct rwlock vmm_kernel_lock = RWLOCK_INIT;
+
 static struct vmm_structures vmm_kernel = {
 	.block_list = LIST_INIT(vmm_kernel.block_list),
 	.alloc_list = LIST_INIT(vmm_kernel.alloc_list),
@@ -83,6 +127,8 @@ static void vmm_block_init(void *p)
 	struct vmm_block *block = p;
 
 	block->flags = 0;
+	block->zero_pages = 0;
+	spin_init(&block->page_lock);
 	block->mapped = NULL;
 	list_init(&block->area.list);
 	list_init(&block->global_list);
@@ -267,6 +313,10 @@ static struct vmm_block *vmm_find_addr(struct vmm_structures *s, addr_t addr)
 void vmm_init(void)
 {
 	struct vmm_block *first;
+	int i;
+
+	for (i = 0; i < VMM_SMALL_CLASSES; ++i)
+		list_init(&vmm_small_pages[i]);
 
 	vmm_block_cache = create_cache("vmm_block", sizeof (struct vmm_block),
 	                               SLAB_MIN_ALIGN, SLAB_PANIC,
@@ -324,7 +374,7 @@ static struct vmm_block *vmm_split(struct vmm_block *block,
 		new->vmm = block->vmm;
 		list_add(&block->global_list, &new->global_list);
 		block = new;
-	} else if (size != block->area.size) {
+	} else {
 		/* base == block->area.base */
 		block->area.size = size;
 		vmm_tree_delete(s, block);
@@ -351,69 +401,6 @@ static struct vmm_block *vmm_split(struct vmm_block *block,
 	return block;
 }
 
-/*
- * vmm_split_small:
- * Split a vmm_block into multiple blocks, one of which
- * starts at `base` and has size `size` < PAGE_SIZE.
- */
-static struct vmm_block *vmm_split_small(struct vmm_block *block,
-                                         addr_t base, size_t size)
-{
-	struct vmm_block *new, *ret;
-
-	/*
-	 * Blocks with size < PAGE_SIZE are not allowed to cross page
-	 * boundaries. If `block` and `base` are on different pages,
-	 * `block` is shrunk to end at the start of `base`s page, and a
-	 * new block is created to span [page, base).
-	 */
-	if (block->area.size >= PAGE_SIZE) {
-		new = vmm_block_alloc();
-		ret = vmm_block_alloc();
-
-		if (IS_ERR(new))
-			return new;
-		if (IS_ERR(ret))
-			return ret;
-
-		block->area.size -= PAGE_SIZE;
-		vmm_size_tree_delete(&vmm_kernel.size_tree, block);
-		vmm_size_tree_insert(&vmm_kernel.size_tree, block);
-
-		new->area.base = base & PAGE_MASK;
-		new->area.size = PAGE_SIZE - size;
-		new->vmm = NULL;
-		list_add(&block->global_list, &new->global_list);
-		vmm_tree_insert(&vmm_kernel, new);
-
-		ret->area.base = base;
-		ret->area.size = size;
-		ret->vmm = NULL;
-		list_add(&new->global_list, &ret->global_list);
-	} else {
-		ret = vmm_block_alloc();
-		if (IS_ERR(ret))
-			return ret;
-
-		block->area.size -= size;
-		vmm_size_tree_delete(&vmm_kernel.size_tree, block);
-		vmm_size_tree_insert(&vmm_kernel.size_tree, block);
-
-		ret->area.base = base;
-		ret->area.size = size;
-		ret->vmm = NULL;
-		list_add(&block->global_list, &ret->global_list);
-
-		/* a page has already been allocated; `ret` will share it */
-		if (block->mapped) {
-			ret->mapped = block->mapped;
-			PM_REFCOUNT_INC(block->mapped);
-		}
-	}
-
-	return ret;
-}
-
 /*
  * vmm_try_coalesce:
  * Attempt to merge `block` with its unallocated neighbours
@@ -430,7 +417,7 @@ static struct vmm_block *vmm_try_coalesce(struct vmm_block *block)
 
 	rb_delete(&s->addr_tree, &block->addr_node);
 	list_del(&block->area.list);
-	block->flags &= ~VMM_ALLOCATED;
+	block->flags &= ~(VMM_ALLOCATED | VMM_GUARD);
 
 	new_base = block->area.base;
 	new_size = block->area.size;
@@ -438,8 +425,7 @@ static struct vmm_block *vmm_try_coalesce(struct vmm_block *block)
 	/* merge with lower address blocks */
 	while (block->global_list.prev != &s->block_list) {
 		neighbour = list_prev_entry(block, global_list);
-		if (neighbour->flags & VMM_ALLOCATED ||
-		    neighbour->area.size < PAGE_SIZE)
+		if (neighbour->flags & VMM_ALLOCATED)
 			break;
 
 		new_base = neighbour->area.base;
@@ -453,8 +439,7 @@ static struct vmm_block *vmm_try_coalesce(struct vmm_block *block)
 	/* merge with higher address blocks */
 	while (block->global_list.next != &s->block_list) {
 		neighbour = list_next_entry(block, global_list);
-		if (neighbour->flags & VMM_ALLOCATED ||
-		    neighbour->area.size < PAGE_SIZE)
+		if (neighbour->flags & VMM_ALLOCATED)
 			break;
 
 		new_size += neighbour->area.size;
@@ -471,102 +456,11 @@ static struct vmm_block *vmm_try_coalesce(struct vmm_block *block)
 	return block;
 }
 
-/*
- * vmm_try_coalesce_small:
- * Attempt to merge small vmm_block `block` with adjacent unallocated
- * vmm_blocks which share the same virtual page.
- */
-static struct vmm_block *vmm_try_coalesce_small(struct vmm_block *block)
-{
-	struct vmm_block *neighbour;
-	addr_t new_base, page;
-	size_t new_size;
-
-	rb_delete(&vmm_kernel.addr_tree, &block->addr_node);
-	list_del(&block->area.list);
-	block->flags &= ~VMM_ALLOCATED;
-
-	new_base = block->area.base;
-	new_size = block->area.size;
-	page = block->area.base & PAGE_SIZE;
-
-	/* merge with lower address blocks on the same page */
-	while (block->global_list.prev != &vmm_kernel.block_list) {
-		neighbour = list_prev_entry(block, global_list);
-		if (neighbour->flags & VMM_ALLOCATED ||
-		    (neighbour->area.base & PAGE_SIZE) != page)
-			break;
-
-		new_base = neighbour->area.base;
-		new_size += neighbour->area.size;
-
-		list_del(&neighbour->global_list);
-		vmm_tree_delete(&vmm_kernel, neighbour);
-		vmm_block_free(neighbour);
-	}
-
-	/* merge with higher address blocks on the same page */
-	while (block->global_list.next != &vmm_kernel.block_list) {
-		neighbour = list_next_entry(block, global_list);
-		if (neighbour->flags & VMM_ALLOCATED ||
-		    (neighbour->area.base & PAGE_SIZE) != page)
-			break;
-
-		new_size += neighbour->area.size;
-
-		list_del(&neighbour->global_list);
-		vmm_tree_delete(&vmm_kernel, neighbour);
-		vmm_block_free(neighbour);
-	}
-
-	block->area.base = new_base;
-	block->area.size = new_size;
-	vmm_tree_insert(&vmm_kernel, block);
-
-	return block;
-}
-
-/*
- * __vmm_small_set_mapped:
- * Find all vmm_blocks that share a page with `block`
- * and mark them as being mapped.
- */
-static __always_inline void __vmm_small_set_mapped(struct vmm_block *block)
-{
-	struct vmm_block *b;
-	addr_t page;
-	unsigned int refcount, n;
-
-	page = block->area.base & PAGE_MASK;
-	refcount = PM_PAGE_REFCOUNT(block->mapped);
-	n = 0;
-
-	list_for_each_entry_r(b, &block->global_list, global_list) {
-		if ((b->area.base & PAGE_MASK) != page)
-			break;
-		b->mapped = block->mapped;
-		if (b->flags & VMM_ALLOCATED)
-			++n;
-	}
-
-	list_for_each_entry(b, &block->global_list, global_list) {
-		if ((b->area.base & PAGE_MASK) != page)
-			break;
-		b->mapped = block->mapped;
-		if (b->flags & VMM_ALLOCATED)
-			++n;
-	}
-
-	PM_SET_REFCOUNT(block->mapped, refcount + n);
-}
-
 static __always_inline void __vmm_add_area_pages(struct vmm_block *block,
                                                  struct page *p)
 {
 	if (!block->mapped) {
 		block->mapped = p;
-		if (block->area.size < PAGE_SIZE)
-			__vmm_small_set_mapped(block);
 	} else {
 		list_ins(&block->mapped->list, &p->list);
 	}
@@ -575,9 +469,11 @@ static __always_inline void __vmm_add_area_pages(struct vmm_block *block,
 /*
  * vmm_alloc_block_pages:
  * Allocate physical pages for the whole address range of the given vmm_block.
+ * Large physically contiguous blocks are preferred, but smaller orders are
+ * used when they are unavailable. Return 0 if the full range was populated.
  * Note: this is almost always a _bad_ idea.
  */
-static void vmm_alloc_block_pages(struct vmm_block *block)
+static int vmm_alloc_block_pages(struct vmm_block *block)
 {
 	struct page *p;
 	addr_t base, end;
@@ -586,18 +482,22 @@ static void vmm_alloc_block_pages(struct vmm_block *block)
 
 	base = block->area.base;
 	end = block->area.base + block->area.size;
-	pages = block->area.size / PAGE_SIZE;
+	if (block->flags & VMM_GUARD)
+		base += PAGE_SIZE;
+	pages = (end - base) / PAGE_SIZE;
 
 	while (base < end) {
 		ord = min(log2(pages), PA_MAX_ORDER);
 
 		p = alloc_pages(PA_USER, ord);
+		while (IS_ERR(p) && ord)
+			p = alloc_pages(PA_USER, --ord);
 		/*
 		 * It's OK if this fails; there will be a second chance
 		 * when the page fault handler is hit.
 		 */
 		if (IS_ERR(p))
-			return;
+			return ERR_VAL(p);
 
 		map_pages_kernel(base, page_to_phys(p), PROT_WRITE,
 		                 PAGE_CP_DEFAULT, pow2(ord));
@@ -607,60 +507,75 @@ static void vmm_alloc_block_pages(struct vmm_block *block)
 		pages -= pow2(ord);
 		base += pow2(ord) * PAGE_SIZE;
 	}
+
+	return 0;
 }
 
 /*
- * vmm_alloc_size_kernel:
- * Allocate a vmm_block of size `size` from the kernel address space.
+ * __vmm_alloc_kernel_block:
+ * Allocate a vmm_block of `size` bytes, a multiple of PAGE_SIZE, from the
+ * kernel address space. vmm_kernel_lock must be held for writing.
+ * The block is not added to the list of allocated blocks.
  */
-static struct vmm_area *vmm_alloc_size_kernel(size_t size, unsigned long flags)
+static struct vmm_block *__vmm_alloc_kernel_block(size_t size)
 {
 	struct vmm_block *block;
 	addr_t base;
-	int err;
-	size_t align;
-
-	if (size > PAGE_SIZE / 2) {
-		size = ALIGN(size, PAGE_SIZE);
-	} else if (size > VMM_AREA_MIN_SIZE) {
-		align = pow2(log2(size));
-		size = ALIGN(size, align);
-	} else {
-		size = VMM_AREA_MIN_SIZE;
-	}
 
-	/* TODO: lock vmm_kernel_lock */
 	block = vmm_find_by_size(&vmm_kernel, size);
-	if (!block) {
-		err = ENOMEM;
-		goto out_err;
-	}
+	if (!block)
+		return ERR_PTR(ENOMEM);
 
 	base = block->area.base + block->area.size - size;
+	block = vmm_split(block, base, size);
+	if (IS_ERR(block))
+		return block;
 
-	if (size < PAGE_SIZE)
-		block = vmm_split_small(block, base, size);
-	else
-		block = vmm_split(block, base, size);
+	block->flags |= VMM_ALLOCATED;
+	vmm_addr_tree_insert(&vmm_kernel.alloc_tree, block);
 
+	return block;
+}
+
+/*
+ * vmm_alloc_size_kernel:
+ * Allocate a vmm_block of size `size` from the kernel address space.
+ */
+static struct vmm_area *vmm_alloc_size_kernel(size_t size, unsigned long flags)
+{
+	unsigned long irqstate;
+	struct vmm_block *block;
+	int err;
+
+	size = ALIGN(size, PAGE_SIZE);
+	if (flags & VMM_ALLOC_GUARD)
+		size += PAGE_SIZE;
+
+	write_lock_irqsave(&vmm_kernel_lock, irqstate);
+	block = __vmm_alloc_kernel_block(size);
 	if (IS_ERR(block)) {
-		err = ERR_VAL(block);
-		goto out_err;
+		write_unlock_irqrestore(&vmm_kernel_lock, irqstate);
+		return (void *)block;
 	}
 
-	block->flags |= VMM_ALLOCATED;
+	if (flags & VMM_ALLOC_GUARD)
+		block->flags |= VMM_GUARD;
 	list_ins(&vmm_kernel.alloc_list, &block->area.list);
-	vmm_addr_tree_insert(&vmm_kernel.alloc_tree, block);
-	/* TODO: unlock vmm_kernel_lock */
+	write_unlock_irqrestore(&vmm_kernel_lock, irqstate);
 
-	if (flags & VMM_ALLOC_UPFRONT)
-		vmm_alloc_block_pages(block);
+	/*
+	 * The block is not yet visible to anyone else, so its pages
+	 * can be populated without holding any locks.
+	 */
+	if (flags & VMM_ALLOC_UPFRONT) {
+		err = vmm_alloc_block_pages(block);
+		if (err && (flags & VMM_ALLOC_GUARD)) {
+			vmm_free(&block->area);
+			return ERR_PTR(err);
+		}
+	}
 
 	return &block->area;
-
-out_err:
-	/* TODO: unlock vmm_kernel_lock */
-	return ERR_PTR(err);
 }
 
 static struct vmm_area *__vmm_alloc_size(struct vmm_space *vmm, size_t size,
@@ -707,10 +622,34 @@ static void __vmm_free_pages(struct vmm_space *vmm, struct vmm_block *block)
 	block->mapped = NULL;
 }
 
+/*
+ * __vmm_unmap_zero_pages:
+ * Remove all mappings of the zero page from `block`. As the zero page is
+ * shared, these are not tracked in the block's list of physical pages;
+ * the block is scanned until all of its counted mappings have been found.
+ */
+static void __vmm_unmap_zero_pages(struct vmm_block *block)
+{
+	addr_t addr, end, zero;
+
+	zero = page_to_phys(zero_page);
+	end = block->area.base + block->area.size;
+	for (addr = block->area.base; block->zero_pages && addr < end;
+	     addr += PAGE_SIZE) {
+		if (addr_mapped(addr) && virt_to_phys(addr) == zero) {
+			unmap_page(addr);
+			block->zero_pages--;
+		}
+	}
+}
+
 static void __vmm_free_kernel_pages(struct vmm_block *block)
 {
 	struct page *p;
 
+	if (block->zero_pages)
+		__vmm_unmap_zero_pages(block);
+
 	if (!block->mapped)
 		return;
 
@@ -723,70 +662,118 @@ static void __vmm_free_kernel_pages(struct vmm_block *block)
 	block->mapped = NULL;
 }
 
-/*
- * __vmm_free_small_page:
- * Check if a physical page mapped to multiple small vmm_blocks
- * can be freed and free it if so.
- */
-static void __vmm_free_small_page(struct vmm_block *block)
+/* __vmm_free_kernel: free `block` in kernel address space */
+static void __vmm_free_kernel(struct vmm_block *block)
 {
-	struct vmm_block *b;
-
-	if (!block->mapped)
-		return;
-
-	PM_REFCOUNT_DEC(block->mapped);
-	if (!PM_PAGE_REFCOUNT(block->mapped)) {
-		/* clear `mapped` for all vmm_blocks that share the page */
-		list_for_each_entry_r(b, &block->global_list, global_list) {
-			if (b->mapped != block->mapped)
-				break;
-			b->mapped = NULL;
-		}
+	__vmm_free_kernel_pages(block);
+	vmm_try_coalesce(block);
+}
 
-		list_for_each_entry(b, &block->global_list, global_list) {
-			if (b->mapped != block->mapped)
-				break;
-			b->mapped = NULL;
-		}
+/* vmm_free: free the vmm_area `area` */
+void vmm_free(struct vmm_area *area)
+{
+	unsigned long irqstate;
+	struct vmm_block *block;
 
-		free_pages(block->mapped);
-		block->mapped = NULL;
+	block = (struct vmm_block *)area;
+	if (!block->vmm) {
+		write_lock_irqsave(&vmm_kernel_lock, irqstate);
+		if (block->flags & VMM_ALLOCATED)
+			__vmm_free_kernel(block);
+		write_unlock_irqrestore(&vmm_kernel_lock, irqstate);
+	} else if (block->flags & VMM_ALLOCATED) {
+		__vmm_free_pages(block->vmm, block);
+		vmm_try_coalesce(block);
 	}
 }
 
-/* __vmm_free_kernel: free `block` in kernel address space */
-static void __vmm_free_kernel(struct vmm_block *block)
+/*
+ * vmm_small_alloc:
+ * Allocate an object of at least `size` bytes, at most PAGE_SIZE / 2,
+ * from a small object page. vmm_kernel_lock must be held for writing.
+ */
+static void *vmm_small_alloc(size_t size)
 {
-	if (block->area.size < PAGE_SIZE) {
-		__vmm_free_small_page(block);
-		vmm_try_coalesce_small(block);
-	} else {
-		__vmm_free_kernel_pages(block);
-		vmm_try_coalesce(block);
+	struct vmm_block *block;
+	struct list *head;
+	unsigned int shift, i, obj;
+
+	shift = size > pow2(VMM_SMALL_MIN_SHIFT)
+	        ? log2(size - 1) + 1 : VMM_SMALL_MIN_SHIFT;
+	head = &vmm_small_pages[shift - VMM_SMALL_MIN_SHIFT];
+
+	if (list_empty(head)) {
+		block = __vmm_alloc_kernel_block(PAGE_SIZE);
+		if (IS_ERR(block))
+			return NULL;
+
+		block->flags |= VMM_SMALL;
+		block->small.obj_shift = shift;
+		block->small.nr_free = PAGE_SIZE >> shift;
+		block->small.free_map[0] = block->small.free_map[1] = 0;
+		for (i = 0; i < block->small.nr_free; ++i)
+			block->small.free_map[i / 32] |= 1U << (i % 32);
+		list_add(head, &block->area.list);
 	}
+
+	block = list_first_entry(head, struct vmm_block, area.list);
+	i = block->small.free_map[0] ? 0 : 1;
+	obj = log2(block->small.free_map[i]);
+	block->small.free_map[i] &= ~(1U << obj);
+	obj += i * 32;
+
+	if (!--block->small.nr_free)
+		list_del(&block->area.list);
+
+	return (void *)(block->area.base + (obj << shift));
 }
 
-/* vmm_free: free the vmm_area `area` */
-void vmm_free(struct vmm_area *area)
+/*
+ * vmm_small_free:
+ * Free the object at `addr` in small object page `block`.
+ * vmm_kernel_lock must be held for writing.
+ */
+static void vmm_small_free(struct vmm_block *block, addr_t addr)
 {
-	struct vmm_block *block;
+	struct list *head;
+	unsigned int shift, obj;
 
-	block = (struct vmm_block *)area;
-	if (!(block->flags & VMM_ALLOCATED))
+	shift = block->small.obj_shift;
+	obj = (addr - block->area.base) >> shift;
+	if (block->small.free_map[obj / 32] & (1U << (obj % 32)))
 		return;
 
-	if (!block->vmm) {
+	block->small.free_map[obj / 32] |= 1U << (obj % 32);
+	head = &vmm_small_pages[shift - VMM_SMALL_MIN_SHIFT];
+	if (!block->small.nr_free++)
+		list_add(head, &block->area.list);
+
+	/* keep a single empty page per size class for future allocations */
+	if (block->small.nr_free == PAGE_SIZE >> shift &&
+	    (head->next != &block->area.list ||
+	     head->prev != &block->area.list)) {
+		list_del(&block->area.list);
+		block->flags &= ~VMM_SMALL;
+		rb_init(&block->size_node);
 		__vmm_free_kernel(block);
-	} else {
-		__vmm_free_pages(block->vmm, block);
-		vmm_try_coalesce(block);
 	}
 }
 
 void *vmalloc(size_t size)
 {
+	unsigned long irqstate;
 	struct vmm_area *area;
+	void *ptr;
+
+	if (!size)
+		return NULL;
+
+	if (size <= PAGE_SIZE / 2) {
+		write_lock_irqsave(&vmm_kernel_lock, irqstate);
+		ptr = vmm_small_alloc(size);
+		write_unlock_irqrestore(&vmm_kernel_lock, irqstate);
+		return ptr;
+	}
 
 	area = vmm_alloc_size_kernel(size, 0);
 	if (IS_ERR(area))
@@ -797,29 +784,78 @@ void *vmalloc(size_t size)
 
 void vfree(void *ptr)
 {
+	unsigned long irqstate;
 	struct vmm_block *block;
 
+	write_lock_irqsave(&vmm_kernel_lock, irqstate);
 	block = vmm_find_addr(&vmm_kernel, (addr_t)ptr);
-	if (block)
-		__vmm_free_kernel(block);
+	if (block) {
+		if (block->flags & VMM_SMALL)
+			vmm_small_free(block, (addr_t)ptr);
+		else
+			__vmm_free_kernel(block);
+	}
+	write_unlock_irqrestore(&vmm_kernel_lock, irqstate);
 }
 
 /*
  * vmm_get_allocated_area:
  * Check if `addr` is allocated in address space `vmm`,
  * and return its vmm_area if so.
+ * Nothing prevents the returned area from being freed concurrently;
+ * use vmm_area_lock to operate on a kernel area.
  */
 struct vmm_area *vmm_get_allocated_area(struct vmm_space *vmm, addr_t addr)
 {
+	unsigned long irqstate;
 	struct vmm_block *block;
 
-	block = vmm_find_addr(vmm ? &vmm->structures : &vmm_kernel, addr);
+	if (vmm)
+		return (struct vmm_area *)vmm_find_addr(&vmm->structures, addr);
+
+	read_lock_irqsave(&vmm_kernel_lock, irqstate);
+	block = vmm_find_addr(&vmm_kernel, addr);
+	read_unlock_irqrestore(&vmm_kernel_lock, irqstate);
+
 	return (struct vmm_area *)block;
 }
 
+/*
+ * vmm_area_lock:
+ * Find the allocated kernel area containing `addr` and lock its pages,
+ * returning NULL if `addr` is not allocated. The area cannot be freed
+ * until it is released with vmm_area_unlock, which must be passed the
+ * interrupt state saved in `irqstate`.
+ */
+struct vmm_area *vmm_area_lock(addr_t addr, unsigned long *irqstate)
+{
+	struct vmm_block *block;
+
+	read_lock_irqsave(&vmm_kernel_lock, *irqstate);
+	block = vmm_find_addr(&vmm_kernel, addr);
+	if (!block) {
+		read_unlock_irqrestore(&vmm_kernel_lock, *irqstate);
+		return NULL;
+	}
+
+	spin_lock(&block->page_lock);
+	return &block->area;
+}
+
+/* vmm_area_unlock: release an area locked by vmm_area_lock */
+void vmm_area_unlock(struct vmm_area *area, unsigned long irqstate)
+{
+	struct vmm_block *block;
+
+	block = (struct vmm_block *)area;
+	spin_unlock(&block->page_lock);
+	read_unlock_irqrestore(&vmm_kernel_lock, irqstate);
+}
+
 /*
  * vmm_add_area_pages:
  * Add the block of physical pages represented by `p` to `area`.
+ * Kernel areas must be locked with vmm_area_lock.
  */
 void vmm_add_area_pages(struct vmm_area *area, struct page *p)
 {
@@ -834,6 +870,53 @@ void vmm_add_area_pages(struct vmm_area *area, struct page *p)
 	__vmm_add_area_pages(block, p);
 }
 
+/*
+ * vmm_map_zero_page:
+ * Map the shared zero page read-only at page-aligned address `addr` within
+ * `area`, which must be locked with vmm_area_lock.
+ * The first write to the page triggers a copy-on-write fault.
+ */
+int vmm_map_zero_page(struct vmm_area *area, addr_t addr)
+{
+	struct vmm_block *block;
+	int err;
+
+	block = (struct vmm_block *)area;
+	err = map_page_kernel(addr, page_to_phys(zero_page),
+	                      PROT_COW, PAGE_CP_DEFAULT);
+	if (!err)
+		block->zero_pages++;
+
+	return err;
+}
+
+/*
+ * vmm_unmap_zero_page:
+ * Remove the mapping of the zero page at `addr` within `area`, which must
+ * be locked with vmm_area_lock.
+ */
+void vmm_unmap_zero_page(struct vmm_area *area, addr_t addr)
+{
+	struct vmm_block *block;
+
+	block = (struct vmm_block *)area;
+	unmap_page(addr);
+	block->zero_pages--;
+}
+
+/*
+ * vmm_addr_is_guard:
+ * Return 1 if `addr` lies within the guard page of `area`.
+ */
+int vmm_addr_is_guard(struct vmm_area *area, addr_t addr)
+{
+	struct vmm_block *block;
+
+	block = (struct vmm_block *)area;
+	return (block->flags & VMM_GUARD) && addr >= area->base &&
+	       addr < area->base + PAGE_SIZE;
+}
+
 void vmm_space_dump(struct vmm_space *vmm)
 {
 	struct vmm_structures *s;
@@ -17,59 +17,204 @@
  */
 
 #include <radix/atomic.h>
+#include <radix/cpu.h>
 #include <radix/irq.h>
 #include <radix/mutex.h>
+#include <radix/rcupdate.h>
 #include <radix/sched.h>
 #include <radix/tasking.h>
 
+#define MUTEX_WAITERS           1UL
+#define MUTEX_OWNER_MASK        (~3UL)
+
+/* Owner of a mutex locked before tasking has been started. */
+#define MUTEX_BOOT_OWNER        4UL
+
+/* Maximum number of times to poll a mutex whose owner is running. */
+#define MUTEX_SPIN_MAX          1024
+
 void mutex_init(struct mutex *m)
 {
-	m->count = 0;
+	m->owner = 0;
+	spin_init(&m->wait_lock);
 	list_init(&m->queue);
 }
 
+static __always_inline addr_t mutex_owner_id(void)
+{
+	struct task *curr;
+
+	curr = current_task();
+	return curr ? (addr_t)curr : MUTEX_BOOT_OWNER;
+}
+
+static __always_inline int __mutex_trylock(struct mutex *m, addr_t id)
+{
+	return cmpxchg(&m->owner, 0, id) == 0;
+}
+
+#ifdef CONFIG_SMP
+/*
+ * mutex_optimistic_spin:
+ * Poll `m` for as long as its owner is running on another processor, as
+ * it is likely to release the mutex before a context switch could complete.
+ * Return 1 if the mutex was acquired.
+ *
+ * A mutex with waiters is handed directly to the first of them, so it
+ * appears to be owned by a task which is not running and spinners give up
+ * rather than stealing it from the queue.
+ *
+ * The owner may unlock the mutex and exit at any time; spinning within an
+ * RCU read-side section keeps its task struct from being freed.
+ */
+static int mutex_optimistic_spin(struct mutex *m, addr_t id)
+{
+	struct task *owner;
+	addr_t val;
+	int i, ret;
+
+	ret = 0;
+	rcu_read_lock();
+	for (i = 0; i < MUTEX_SPIN_MAX; ++i) {
+		val = READ_ONCE(m->owner);
+		if (!val) {
+			if (__mutex_trylock(m, id)) {
+				ret = 1;
+				break;
+			}
+			continue;
+		}
+
+		if ((val & MUTEX_OWNER_MASK) == MUTEX_BOOT_OWNER)
+			break;
+
+		owner = (struct task *)(val & MUTEX_OWNER_MASK);
+		if (READ_ONCE(owner->state) != TASK_RUNNING)
+			break;
+
+		cpu_relax();
+	}
+	rcu_read_unlock();
+
+	return ret;
+}
+#else
+/* On a uniprocessor system, the owner cannot be running while we are. */
+#define mutex_optimistic_spin(m, id) ((void)(m), (void)(id), 0)
+#endif /* CONFIG_SMP */
+
+/*
+ * mutex_queue:
+ * Add the current task to the wait queue of `m`, unless the mutex
+ * becomes available. Return 1 if the mutex was acquired instead.
+ * Called with m->wait_lock held.
+ */
+static int mutex_queue(struct mutex *m, struct task *curr)
+{
+	addr_t val;
+
+	while (1) {
+		val = READ_ONCE(m->owner);
+		if (!val) {
+			if (__mutex_trylock(m, (addr_t)curr))
+				return 1;
+			continue;
+		}
+		if ((val & MUTEX_WAITERS) ||
+		    cmpxchg(&m->owner, val, val | MUTEX_WAITERS) == val)
+			break;
+	}
+
+	curr->state = TASK_BLOCKED;
+	list_ins(&m->queue, &curr->queue);
+	return 0;
+}
+
 /*
  * mutex_lock:
- * Attempt to lock mutex `m`. If it is already locked,
- * put thread into a wait and yield CPU.
+ * Attempt to lock mutex `m`. If it is already locked, spin while its owner
+ * is running, then put thread into a wait and yield CPU. Waiters are
+ * granted the mutex in the order in which they arrived.
  */
 void mutex_lock(struct mutex *m)
 {
 	struct task *curr;
+	addr_t id;
 
 	if (unlikely(in_irq()))
 		return;
 
-	while (atomic_swap(&m->count, 1) != 0) {
-		/*
-		 * TODO: this needs to be spinlocked
-		 * when multiprocessing is added
-		 */
-		irq_disable();
-		curr = current_task();
-		curr->state = TASK_BLOCKED;
-		list_ins(&m->queue, &curr->queue);
-		schedule(1);
+	id = mutex_owner_id();
+	if (likely(__mutex_trylock(m, id)))
+		return;
+
+	if (mutex_optimistic_spin(m, id))
+		return;
+
+	/* there is nothing to block before tasking has started */
+	if (unlikely(id == MUTEX_BOOT_OWNER)) {
+		while (!__mutex_trylock(m, id))
+			cpu_relax();
+		return;
+	}
+
+	curr = (struct task *)id;
+	irq_disable();
+	spin_lock(&m->wait_lock);
+	if (mutex_queue(m, curr)) {
+		spin_unlock(&m->wait_lock);
 		irq_enable();
+		return;
 	}
+	spin_unlock(&m->wait_lock);
+
+	/* mutex_unlock hands the mutex directly to the task it wakes */
+	while ((READ_ONCE(m->owner) & MUTEX_OWNER_MASK) != id)
+		schedule(1);
+	irq_enable();
+}
+
+/* mutex_trylock: lock `m` if it is available; return 1 on success */
+int mutex_trylock(struct mutex *m)
+{
+	if (unlikely(in_irq()))
+		return 0;
+
+	return __mutex_trylock(m, mutex_owner_id());
 }
 
-/* mutex_unlock: unlock mutex `m` and wake a waiting thread */
+/*
+ * mutex_unlock:
+ * Unlock mutex `m`. If there are waiting threads, ownership is passed
+ * directly to the first, which is woken.
+ * As with the original counting mutex, `m` need not have been locked by
+ * the current task (e.g. a mutex taken before tasking started).
+ */
 void mutex_unlock(struct mutex *m)
 {
 	struct task *next;
+	unsigned long flags;
+	addr_t id;
 
 	if (unlikely(in_irq()))
 		return;
 
-	m->count = 0;
+	id = mutex_owner_id();
+	if (likely(cmpxchg(&m->owner, id, 0) == id))
+		return;
 
-	/* TODO: this needs to be spinlocked when multiprocessing is added */
-	irq_disable();
-	if (!list_empty(&m->queue)) {
-		next = list_first_entry(&m->queue, struct task, queue);
-		list_del(&next->queue);
-		sched_unblock(next);
+	/* MUTEX_WAITERS is set, or `m` is owned by someone else */
+	spin_lock_irqsave(&m->wait_lock, flags);
+	if (list_empty(&m->queue)) {
+		WRITE_ONCE(m->owner, 0);
+		spin_unlock_irqrestore(&m->wait_lock, flags);
+		return;
 	}
-	irq_enable();
+
+	next = list_first_entry(&m->queue, struct task, queue);
+	list_del(&next->queue);
+	WRITE_ONCE(m->owner, (addr_t)next |
+	           (list_empty(&m->queue) ? 0 : MUTEX_WAITERS));
+	sched_unblock(next);
+	spin_unlock_irqrestore(&m->wait_lock, flags);
 }
@@ -16,12 +16,16 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <radix/bitops.h>
 #include <radix/bits.h>
 #include <radix/bootmsg.h>
 #include <radix/cpu.h>
 #include <radix/kernel.h>
+#include <radix/list.h>
 #include <radix/mm.h>
+#include <radix/mutex.h>
 #include <radix/percpu.h>
+#include <radix/slab.h>
 #include <radix/vmm.h>
 
 #include <rlibc/string.h>
@@ -34,60 +38,311 @@ static addr_t percpu_end = (addr_t)&__percpu_end;
 
 addr_t __percpu_offset[MAX_CPUS];
 
+/*
+ * Per-CPU memory is organized into chunks, each of which consists of one unit
+ * for every possible CPU, spaced `percpu_unit_size` bytes apart. The first
+ * chunk holds the static per-CPU section followed by a reserve for dynamic
+ * allocations; further chunks are created as required and are entirely
+ * dynamic.
+ *
+ * As all units are the same size, the CPU-specific copies of an object at
+ * offset `off` within a chunk's units are at the same distance from each other
+ * as copies of a static per-CPU variable. A pointer to the object is therefore
+ * formed by subtracting percpu_base_offset from the address of its copy in
+ * the first unit, after which it can be used exactly like the address of a
+ * DEFINE_PER_CPU variable.
+ *
+ * Dynamic allocations are made in units of PERCPU_MIN_ALLOC bytes, tracked by
+ * two bitmaps per chunk: one of allocated granules and one marking the first
+ * granule of each allocation.
+ */
+#define PERCPU_DYNAMIC_RESERVE  KIB(2)
+#define PERCPU_MIN_ALLOC        8
+
+struct percpu_chunk {
+	struct list     list;
+	addr_t          base;           /* address of the chunk's first unit */
+	unsigned int    start;          /* first dynamic granule */
+	unsigned int    nr_free;        /* number of free granules */
+	unsigned long   *alloc_map;
+	unsigned long   *start_map;
+};
+
+static size_t percpu_unit_size;
+static unsigned int percpu_nr_units;
+static addr_t percpu_base_offset;
+static unsigned int percpu_unit_granules;
+
+static struct percpu_chunk percpu_first_chunk;
+static struct list percpu_chunks = LIST_INIT(percpu_chunks);
+static struct mutex percpu_alloc_lock = MUTEX_INIT(percpu_alloc_lock);
+
+#define PERCPU_MAP_SIZE \
+	(ALIGN(percpu_unit_granules, BITS_PER_LONG) / BITS_PER_LONG \
+	 * sizeof (unsigned long))
+
 void percpu_init_early(void)
 {
 	memset(__percpu_offset, 0, sizeof __percpu_offset);
 	arch_percpu_init_early();
 }
 
+/*
+ * percpu_chunk_init:
+ * Initialize `chunk` with its first unit at `base`, with dynamic
+ * allocations available from granule `start` onwards.
+ */
+static int percpu_chunk_init(struct percpu_chunk *chunk,
+                             addr_t base, unsigned int start)
+{
+	chunk->alloc_map = kmalloc(2 * PERCPU_MAP_SIZE);
+	if (!chunk->alloc_map)
+		return ENOMEM;
+
+	chunk->start_map = (void *)((addr_t)chunk->alloc_map + PERCPU_MAP_SIZE);
+	memset(chunk->alloc_map, 0, 2 * PERCPU_MAP_SIZE);
+
+	chunk->base = base;
+	chunk->start = start;
+	chunk->nr_free = percpu_unit_granules - start;
+	list_ins(&percpu_chunks, &chunk->list);
+
+	return 0;
+}
+
+/*
+ * percpu_populate_unit:
+ * Back the unit at `addr` with physical memory.
+ */
+static int percpu_populate_unit(addr_t addr)
+{
+	struct vmm_area *area;
+	unsigned long irqstate;
+	struct page *p;
+	addr_t end;
+
+	for (end = addr + percpu_unit_size; addr < end; addr += PAGE_SIZE) {
+		p = alloc_page(PA_USER);
+		if (IS_ERR(p))
+			return ERR_VAL(p);
+
+		area = vmm_area_lock(addr, &irqstate);
+		map_page_kernel(addr, page_to_phys(p), PROT_WRITE,
+		                PAGE_CP_DEFAULT);
+		mark_page_mapped(p, addr);
+		vmm_add_area_pages(area, p);
+		vmm_area_unlock(area, irqstate);
+	}
+
+	return 0;
+}
+
 /*
  * percpu_area_setup:
- * Allocate memory for per-CPU areas for all CPUs and copy
- * the contents of the per-CPU section into each.
+ * Allocate memory for the per-CPU areas of all possible CPUs, copy the
+ * contents of the per-CPU section into each, and release the original.
  */
 void percpu_area_setup(void)
 {
-	size_t percpu_size, align, i;
-	addr_t percpu_base, base_offset;
+	size_t static_size, copy_size, i;
+	addr_t percpu_base;
 	struct vmm_area *area;
 
-	percpu_size = percpu_end - percpu_start;
-	if (percpu_size < PAGE_SIZE / 2) {
-		align = pow2(log2(percpu_size));
-		percpu_size = ALIGN(percpu_size, align);
-	} else {
-		percpu_size = ALIGN(percpu_size, PAGE_SIZE);
-	}
+	/*
+	 * Units are page-aligned so that no two CPUs share a page,
+	 * allowing each unit to be placed in memory local to its CPU.
+	 */
+	copy_size = percpu_end - percpu_start;
+	static_size = ALIGN(copy_size, PERCPU_MIN_ALLOC);
+	percpu_unit_size = ALIGN(static_size + PERCPU_DYNAMIC_RESERVE,
+	                         PAGE_SIZE);
+	percpu_unit_granules = percpu_unit_size / PERCPU_MIN_ALLOC;
+	percpu_nr_units = possible_cpus();
 
-	area = vmm_alloc_size(NULL, percpu_size * MAX_CPUS, VMM_ALLOC_UPFRONT);
+	area = vmm_alloc_size(NULL, percpu_unit_size * percpu_nr_units, 0);
 	if (IS_ERR(area))
 		panic("failed to allocate space for per-CPU areas\n");
 
 	percpu_base = area->base;
-	base_offset = percpu_base - percpu_start;
+	percpu_base_offset = percpu_base - percpu_start;
 
-	for (i = 0; i < MAX_CPUS; ++i) {
-		__percpu_offset[i] = base_offset + i * percpu_size;
-		memcpy((void *)percpu_base, (void *)percpu_start, percpu_size);
-		percpu_base += percpu_size;
+	for (i = 0; i < percpu_nr_units; ++i) {
+		if (percpu_populate_unit(percpu_base) != 0) {
+			panic("failed to allocate per-CPU area for CPU %d\n",
+			      i);
+		}
+
+		__percpu_offset[i] = percpu_base_offset + i * percpu_unit_size;
+		memcpy((void *)percpu_base, (void *)percpu_start, copy_size);
+		memset((void *)(percpu_base + copy_size), 0,
+		       percpu_unit_size - copy_size);
+		percpu_base += percpu_unit_size;
 	}
 
+	if (percpu_chunk_init(&percpu_first_chunk, area->base,
+	                      static_size / PERCPU_MIN_ALLOC) != 0)
+		panic("failed to initialize first per-CPU chunk\n");
+
 	arch_percpu_init();
 
-	/*
-	 * TODO: we no longer need the original per-CPU area, so we can add
-	 * it to the page allocator. (Requires adding an additional zone_init
-	 * call in buddy_populate of page.c to handle the .percpu_data section.)
-	 */
+	/* the boot copy of the per-CPU section is no longer referenced */
+	buddy_reclaim(percpu_start, percpu_end);
+
+	BOOT_OK_MSG("percpu: allocated %u pages for %d CPU%s "
+		    "(%u page%s per CPU)\n",
+		    percpu_unit_size / PAGE_SIZE * percpu_nr_units,
+		    percpu_nr_units, percpu_nr_units > 1 ? "s" : "",
+		    percpu_unit_size / PAGE_SIZE,
+		    percpu_unit_size > PAGE_SIZE ? "s" : "");
+}
+
+/*
+ * percpu_chunk_create:
+ * Allocate a new, entirely dynamic per-CPU chunk.
+ * Its pages are populated on demand as CPUs access their units.
+ */
+static struct percpu_chunk *percpu_chunk_create(void)
+{
+	struct percpu_chunk *chunk;
+	struct vmm_area *area;
+
+	chunk = kmalloc(sizeof *chunk);
+	if (!chunk)
+		return NULL;
+
+	area = vmm_alloc_size(NULL, percpu_unit_size * percpu_nr_units, 0);
+	if (IS_ERR(area)) {
+		kfree(chunk);
+		return NULL;
+	}
+
+	if (percpu_chunk_init(chunk, area->base, 0) != 0) {
+		vmm_free(area);
+		kfree(chunk);
+		return NULL;
+	}
+
+	return chunk;
+}
+
+/*
+ * percpu_chunk_alloc:
+ * Find `n` free granules in `chunk`, with the first aligned to a multiple
+ * of `align` granules. Mark them as allocated and return the first,
+ * or -1 if there is no space.
+ */
+static int percpu_chunk_alloc(struct percpu_chunk *chunk,
+                              unsigned int n, unsigned int align)
+{
+	unsigned int bit, next, i;
+
+	if (chunk->nr_free < n)
+		return -1;
+
+	bit = ALIGN(chunk->start, align);
+	while (bit + n <= percpu_unit_granules) {
+		next = find_next_bit(chunk->alloc_map, bit + n, bit);
+		if (next == bit + n) {
+			for (i = bit; i < next; ++i)
+				__set_bit(i, chunk->alloc_map);
+			__set_bit(bit, chunk->start_map);
+			chunk->nr_free -= n;
+			return bit;
+		}
+		next = find_next_zero_bit(chunk->alloc_map,
+		                          percpu_unit_granules, next + 1);
+		bit = ALIGN(next, align);
+	}
+
+	return -1;
+}
+
+/*
+ * alloc_percpu:
+ * Allocate a zeroed object of `size` bytes for every CPU, aligned to `align`.
+ * The returned pointer can be used with the per-CPU accessors in the same way
+ * as the address of a statically defined per-CPU variable.
+ */
+void *alloc_percpu(size_t size, size_t align)
+{
+	struct percpu_chunk *chunk;
+	unsigned int n, galign;
+	addr_t addr;
+	void *ptr;
+	int bit, cpu;
+
+	if (!size || !percpu_unit_size)
+		return NULL;
+
+	align = max(align, (size_t)PERCPU_MIN_ALLOC);
+	if (align != pow2(log2(align)) || align > PAGE_SIZE)
+		return NULL;
+
+	n = ALIGN(size, PERCPU_MIN_ALLOC) / PERCPU_MIN_ALLOC;
+	galign = align / PERCPU_MIN_ALLOC;
+	if (n > percpu_unit_granules)
+		return NULL;
+
+	mutex_lock(&percpu_alloc_lock);
+
+	bit = -1;
+	list_for_each_entry(chunk, &percpu_chunks, list) {
+		if ((bit = percpu_chunk_alloc(chunk, n, galign)) >= 0)
+			break;
+	}
+
+	if (bit < 0) {
+		chunk = percpu_chunk_create();
+		if (chunk)
+			bit = percpu_chunk_alloc(chunk, n, galign);
+		if (bit < 0) {
+			mutex_unlock(&percpu_alloc_lock);
+			return NULL;
+		}
+	}
+
+	mutex_unlock(&percpu_alloc_lock);
+
+	addr = chunk->base + bit * PERCPU_MIN_ALLOC;
+	ptr = (void *)(addr - percpu_base_offset);
+
+	for (cpu = 0; cpu < (int)percpu_nr_units; ++cpu)
+		memset(per_cpu_ptr(ptr, cpu), 0, size);
+
+	return ptr;
+}
+
+/* free_percpu: free per-CPU object `ptr` allocated by alloc_percpu */
+void free_percpu(void *ptr)
+{
+	struct percpu_chunk *chunk;
+	unsigned int bit;
+	addr_t addr;
+
+	if (!ptr)
+		return;
+
+	addr = (addr_t)ptr + percpu_base_offset;
+
+	mutex_lock(&percpu_alloc_lock);
+	list_for_each_entry(chunk, &percpu_chunks, list) {
+		if (addr < chunk->base ||
+		    addr >= chunk->base + percpu_unit_size)
+			continue;
+
+		bit = (addr - chunk->base) / PERCPU_MIN_ALLOC;
+		if (!test_bit(bit, chunk->start_map))
+			break;
 
-	if (percpu_size < PAGE_SIZE) {
-		BOOT_OK_MSG("percpu: allocated %uB for %d CPUs (%uB per CPU)\n",
-			    percpu_size * MAX_CPUS, MAX_CPUS, percpu_size);
-	} else {
-		BOOT_OK_MSG("percpu: allocated %u pages for %d CPUs "
-			    "(%u page%s per CPU)\n",
-			    percpu_size / PAGE_SIZE * MAX_CPUS,
-			    MAX_CPUS, percpu_size / PAGE_SIZE,
-			    percpu_size > PAGE_SIZE ? "s" : "");
+		__clear_bit(bit, chunk->start_map);
+		do {
+			__clear_bit(bit, chunk->alloc_map);
+			chunk->nr_free++;
+			++bit;
+		} while (bit < percpu_unit_granules &&
+		         test_bit(bit, chunk->alloc_map) &&
+		         !test_bit(bit, chunk->start_map));
+		break;
 	}
+	mutex_unlock(&percpu_alloc_lock);
 }
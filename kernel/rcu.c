@@ -0,0 +1,138 @@
+/*
+ * kernel/rcu.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/cpu.h>
+#include <radix/cpumask.h>
+#include <radix/error.h>
+#include <radix/irq.h>
+#include <radix/kernel.h>
+#include <radix/kthread.h>
+#include <radix/rcupdate.h>
+#include <radix/sched.h>
+#include <radix/smp.h>
+#include <radix/spinlock.h>
+
+#include <rlibc/string.h>
+
+DEFINE_PER_CPU(unsigned long, rcu_qs_count) = 0;
+
+/* Callbacks waiting for a grace period, in the order they were queued. */
+static struct rcu_head *rcu_cb_head;
+static struct rcu_head **rcu_cb_tail = &rcu_cb_head;
+static spinlock_t rcu_cb_lock = SPINLOCK_INIT;
+
+static struct task *rcu_task;
+
+/*
+ * synchronize_rcu:
+ * Wait until every RCU read-side critical section which was active when
+ * this function was called has completed. Must not be called from within
+ * an RCU read-side critical section.
+ */
+void synchronize_rcu(void)
+{
+	unsigned long snap[MAX_CPUS];
+	unsigned long *count;
+	int cpu, self;
+
+	self = processor_id();
+	for_each_online_cpu(cpu)
+		snap[cpu] = READ_ONCE(*per_cpu_ptr(&rcu_qs_count, cpu));
+
+	/* the calling processor is in a quiescent state by definition */
+	for_each_online_cpu(cpu) {
+		if (cpu == self)
+			continue;
+
+		count = per_cpu_ptr(&rcu_qs_count, cpu);
+		while (READ_ONCE(*count) == snap[cpu]) {
+			schedule(1);
+			cpu_relax();
+		}
+	}
+
+	smp_mb();
+}
+
+/*
+ * call_rcu:
+ * Arrange for `func` to be called with `head` after a grace period has
+ * elapsed. `head` is typically embedded in the object to be freed.
+ */
+void call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *))
+{
+	unsigned long flags;
+	struct task *t;
+
+	head->func = func;
+	head->next = NULL;
+
+	spin_lock_irqsave(&rcu_cb_lock, flags);
+	*rcu_cb_tail = head;
+	rcu_cb_tail = &head->next;
+
+	t = rcu_task;
+	if (t && t->state == TASK_BLOCKED)
+		sched_unblock(t);
+	spin_unlock_irqrestore(&rcu_cb_lock, flags);
+}
+
+/*
+ * rcu_thread:
+ * Wait for a grace period on behalf of each batch of queued callbacks,
+ * then invoke them. Running callbacks from a thread allows them to sleep,
+ * for example in order to free memory.
+ */
+static void rcu_thread(void *arg)
+{
+	struct rcu_head *list, *next;
+
+	(void)arg;
+
+	while (1) {
+		irq_disable();
+		spin_lock(&rcu_cb_lock);
+		list = rcu_cb_head;
+		rcu_cb_head = NULL;
+		rcu_cb_tail = &rcu_cb_head;
+		if (!list) {
+			current_task()->state = TASK_BLOCKED;
+			spin_unlock(&rcu_cb_lock);
+			schedule(1);
+			irq_enable();
+			continue;
+		}
+		spin_unlock(&rcu_cb_lock);
+		irq_enable();
+
+		synchronize_rcu();
+
+		for (; list; list = next) {
+			next = list->next;
+			list->func(list);
+		}
+	}
+}
+
+void rcu_init(void)
+{
+	rcu_task = kthread_run(rcu_thread, NULL, 0, "rcu");
+	if (IS_ERR(rcu_task))
+		panic("failed to create rcu thread: %s\n",
+		      strerror(ERR_VAL(rcu_task)));
+}
@@ -0,0 +1,179 @@
+/*
+ * kernel/rwsem.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/cpu.h>
+#include <radix/irq.h>
+#include <radix/rwsem.h>
+#include <radix/sched.h>
+#include <radix/tasking.h>
+
+#define RWSEM_READ      0
+#define RWSEM_WRITE     1
+
+/* A task waiting on a semaphore. Lives on the waiting task's stack. */
+struct rwsem_waiter {
+	struct list     list;
+	struct task     *task;
+	int             type;
+	int             granted;
+};
+
+void init_rwsem(struct rw_semaphore *sem)
+{
+	sem->count = 0;
+	spin_init(&sem->wait_lock);
+	list_init(&sem->wait_list);
+}
+
+static __always_inline int __rwsem_can_read(struct rw_semaphore *sem)
+{
+	return sem->count >= 0 && list_empty(&sem->wait_list);
+}
+
+static __always_inline int __rwsem_can_write(struct rw_semaphore *sem)
+{
+	return sem->count == 0 && list_empty(&sem->wait_list);
+}
+
+/*
+ * rwsem_wake:
+ * Grant the semaphore to the task at the front of the wait queue or,
+ * if that is a reader, to every reader before the next waiting writer.
+ * Called with sem->wait_lock held and the semaphore free.
+ */
+static void rwsem_wake(struct rw_semaphore *sem)
+{
+	struct rwsem_waiter *waiter;
+
+	while (!list_empty(&sem->wait_list)) {
+		waiter = list_first_entry(&sem->wait_list,
+		                          struct rwsem_waiter, list);
+		if (waiter->type == RWSEM_WRITE) {
+			if (sem->count)
+				return;
+			sem->count = -1;
+		} else {
+			sem->count++;
+		}
+
+		list_del(&waiter->list);
+		WRITE_ONCE(waiter->granted, 1);
+		sched_unblock(waiter->task);
+
+		if (waiter->type == RWSEM_WRITE)
+			return;
+	}
+}
+
+/*
+ * rwsem_wait:
+ * Queue the current task on `sem` and sleep until the semaphore has been
+ * granted to it. Called with interrupts disabled and sem->wait_lock held,
+ * which is released.
+ */
+static void rwsem_wait(struct rw_semaphore *sem, int type)
+{
+	struct rwsem_waiter waiter;
+
+	waiter.task = current_task();
+	waiter.type = type;
+	waiter.granted = 0;
+
+	waiter.task->state = TASK_BLOCKED;
+	list_ins(&sem->wait_list, &waiter.list);
+	spin_unlock(&sem->wait_lock);
+
+	while (!READ_ONCE(waiter.granted))
+		schedule(1);
+}
+
+/* down_read: acquire `sem` for reading, sleeping if necessary */
+void down_read(struct rw_semaphore *sem)
+{
+	irq_disable();
+	spin_lock(&sem->wait_lock);
+	if (likely(__rwsem_can_read(sem))) {
+		sem->count++;
+		spin_unlock(&sem->wait_lock);
+	} else {
+		rwsem_wait(sem, RWSEM_READ);
+	}
+	irq_enable();
+}
+
+int down_read_trylock(struct rw_semaphore *sem)
+{
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&sem->wait_lock, flags);
+	ret = __rwsem_can_read(sem);
+	if (ret)
+		sem->count++;
+	spin_unlock_irqrestore(&sem->wait_lock, flags);
+
+	return ret;
+}
+
+void up_read(struct rw_semaphore *sem)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&sem->wait_lock, flags);
+	if (--sem->count == 0)
+		rwsem_wake(sem);
+	spin_unlock_irqrestore(&sem->wait_lock, flags);
+}
+
+/* down_write: acquire `sem` exclusively, sleeping if necessary */
+void down_write(struct rw_semaphore *sem)
+{
+	irq_disable();
+	spin_lock(&sem->wait_lock);
+	if (likely(__rwsem_can_write(sem))) {
+		sem->count = -1;
+		spin_unlock(&sem->wait_lock);
+	} else {
+		rwsem_wait(sem, RWSEM_WRITE);
+	}
+	irq_enable();
+}
+
+int down_write_trylock(struct rw_semaphore *sem)
+{
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&sem->wait_lock, flags);
+	ret = __rwsem_can_write(sem);
+	if (ret)
+		sem->count = -1;
+	spin_unlock_irqrestore(&sem->wait_lock, flags);
+
+	return ret;
+}
+
+void up_write(struct rw_semaphore *sem)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&sem->wait_lock, flags);
+	sem->count = 0;
+	rwsem_wake(sem);
+	spin_unlock_irqrestore(&sem->wait_lock, flags);
+}
@@ -16,36 +16,524 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <radix/atomic.h>
+#include <radix/bitops.h>
+#include <radix/cpu.h>
+#include <radix/cpumask.h>
+#include <radix/error.h>
+#include <radix/fpu.h>
 #include <radix/irq.h>
+#include <radix/kernel.h>
+#include <radix/preempt.h>
+#include <radix/rbtree.h>
+#include <radix/rcupdate.h>
 #include <radix/sched.h>
+#include <radix/smp.h>
+#include <radix/spinlock.h>
 #include <radix/tasking.h>
+#include <radix/tick.h>
 
 DEFINE_PER_CPU(struct task *, current_task) = NULL;
+DEFINE_PER_CPU(int, preempt_count) = 0;
 
-/* For temporary basic RR scheduler. */
-static struct list task_queue;
+/*
+ * Tasks are scheduled under one of two policies.
+ *
+ * SCHED_PRIO tasks have fixed priorities. They are kept in one FIFO queue
+ * per priority level, with a bitmap recording which levels are non-empty,
+ * so the next task to run is found with a single bit scan regardless of
+ * the number of tasks. A task which exhausts its time slice is moved to the
+ * expired array with a fresh slice; once no tasks remain in the active
+ * array, the two arrays are swapped. Every SCHED_PRIO task therefore gets
+ * to run once per round, however low its priority.
+ *
+ * SCHED_NORMAL tasks share the processor fairly. Each accumulates virtual
+ * runtime at a rate inversely proportional to its priority's weight, and
+ * the task which has received the least is run next. Runnable tasks are
+ * kept in a red-black tree ordered by vruntime, with the leftmost node
+ * cached.
+ *
+ * Runnable SCHED_PRIO tasks always take precedence over SCHED_NORMAL ones.
+ *
+ * Each processor may also have an idle task, which belongs to neither
+ * policy. It is never queued, and is only run when both the SCHED_PRIO
+ * arrays and the SCHED_NORMAL tree are empty.
+ *
+ * Each processor has its own runqueue. A waking task is placed on the
+ * processor it last ran on, to reuse its cache, unless the waking
+ * processor is less loaded. A processor which runs out of tasks steals
+ * one from the busiest runqueue, and every SCHED_BALANCE_INTERVAL ticks
+ * processors pull tasks from the busiest runqueue to even out the load.
+ *
+ * A task can be woken before it has finished switching out of its
+ * processor, e.g. by a waker on another processor after it has marked
+ * itself blocked. Until its `on_cpu` flag is cleared by switch_to_task,
+ * such a task is only ever queued on the processor it is running on and
+ * is never migrated, so that no other processor can run it on the same
+ * stack.
+ */
+struct prio_array {
+	unsigned int    nr_running;
+	DECLARE_BITMAP(bitmap, SCHED_PRIO_LEVELS);
+	struct list     queue[SCHED_PRIO_LEVELS];
+};
+
+struct cfs_rq {
+	unsigned int    nr_running;
+	unsigned long   load;
+	uint64_t        min_vruntime;
+	struct rb_root  root;
+	struct rb_node  *leftmost;
+};
+
+struct runqueue {
+	spinlock_t              lock;
+	int                     cpu;
+	unsigned int            nr_running;
+	int                     need_resched;
+	unsigned int            balance_ticks;
+	struct prio_array       *active;
+	struct prio_array       *expired;
+	struct prio_array       arrays[2];
+	struct cfs_rq           cfs;
+	struct task             *idle;
+};
+
+static DEFINE_PER_CPU(struct runqueue, runqueue);
+
+#define cpu_rq(cpu)     per_cpu_ptr(&runqueue, cpu)
+#define this_rq()       raw_cpu_ptr(&runqueue)
+#define rq_curr(rq)     (*per_cpu_ptr(&current_task, (rq)->cpu))
+
+/* Number of ticks between periodic load balancing runs. */
+#define SCHED_BALANCE_INTERVAL  100
 
 static int sched_active = 0;
 
+/*
+ * Period within which every runnable SCHED_NORMAL task should run once.
+ * Slices are calculated in microseconds to keep the division in 32 bits.
+ */
+#define SCHED_LATENCY_US        20000UL
+#define SCHED_LATENCY_NS        (SCHED_LATENCY_US * 1000ULL)
+/* Minimum time a SCHED_NORMAL task runs before it can be preempted. */
+#define SCHED_MIN_GRAN_NS       4000000ULL
+/* Amount by which a waking task must lead the current one to preempt it. */
+#define SCHED_WAKEUP_GRAN_NS    1000000ULL
+/* Maximum vruntime credit given to a task which has been sleeping. */
+#define SCHED_SLEEPER_CREDIT_NS (SCHED_LATENCY_NS / 2)
+
+#define SCHED_WEIGHT_DEFAULT    1024
+
+/*
+ * Weights of SCHED_NORMAL tasks by priority. Each level receives 25% more
+ * processor time than the level below it.
+ */
+static const unsigned long sched_prio_weight[SCHED_PRIO_LEVELS] = {
+	 36380,  29104,  23283,  18626,  14901,  11921,   9537,   7629,
+	  6104,   4883,   3906,   3125,   2500,   2000,   1600,   1280,
+	  1024,    819,    655,    524,    419,    336,    268,    215,
+	   172,    137,    110,     88,     70,     56,     45,     36
+};
+
+#define task_weight(t) (sched_prio_weight[(t)->priority])
+
+#define vruntime_before(a, b) ((int64_t)((a) - (b)) < 0)
+
+static void prio_array_init(struct prio_array *array)
+{
+	int i;
+
+	array->nr_running = 0;
+	for (i = 0; i < SCHED_PRIO_LEVELS; ++i) {
+		list_init(&array->queue[i]);
+		__clear_bit(i, array->bitmap);
+	}
+}
+
+static void runqueue_init(struct runqueue *rq, int cpu)
+{
+	spin_init(&rq->lock);
+	rq->cpu = cpu;
+	rq->nr_running = 0;
+	rq->need_resched = 0;
+	rq->balance_ticks = SCHED_BALANCE_INTERVAL;
+	prio_array_init(&rq->arrays[0]);
+	prio_array_init(&rq->arrays[1]);
+	rq->active = &rq->arrays[0];
+	rq->expired = &rq->arrays[1];
+
+	rq->cfs.nr_running = 0;
+	rq->cfs.load = 0;
+	rq->cfs.min_vruntime = 0;
+	rq->cfs.root = RB_ROOT;
+	rq->cfs.leftmost = NULL;
+	rq->idle = NULL;
+}
+
 void sched_init(void)
 {
+	unsigned int cpu;
+
 	if (!sched_active) {
-		list_init(&task_queue);
+		for (cpu = 0; cpu < possible_cpus(); ++cpu)
+			runqueue_init(cpu_rq(cpu), cpu);
 		sched_active = 1;
 	}
 }
 
 /*
- * schedule: select a task to run.
- * If preempt is 1, the current running task is preempted
- * and replaced with the new scheduled task.
+ * sched_timeslice:
+ * Length of the time slice given to a SCHED_PRIO task of priority `prio`,
+ * in ticks. Higher priority tasks receive longer slices.
  */
-void schedule(int preempt)
+static __always_inline int sched_timeslice(int prio)
 {
+	return SCHED_MIN_TIMESLICE +
+	       (SCHED_PRIO_LEVELS - 1 - prio) * SCHED_TIMESLICE_STEP;
+}
+
+static void enqueue_prio(struct prio_array *array, struct task *t)
+{
+	list_ins(&array->queue[t->priority], &t->queue);
+	__set_bit(t->priority, array->bitmap);
+	array->nr_running++;
+}
+
+static void dequeue_prio(struct prio_array *array, struct task *t)
+{
+	list_del(&t->queue);
+	if (list_empty(&array->queue[t->priority]))
+		__clear_bit(t->priority, array->bitmap);
+	array->nr_running--;
+}
+
+static struct task *pick_next_prio(struct runqueue *rq)
+{
+	struct prio_array *array;
+	struct task *t;
+	int prio;
+
+	if (!rq->active->nr_running) {
+		array = rq->active;
+		rq->active = rq->expired;
+		rq->expired = array;
+	}
+
+	array = rq->active;
+	prio = find_first_bit(array->bitmap, SCHED_PRIO_LEVELS);
+	t = list_first_entry(&array->queue[prio], struct task, queue);
+	dequeue_prio(array, t);
+
+	return t;
+}
+
+static __always_inline unsigned int prio_nr_running(struct runqueue *rq)
+{
+	return rq->active->nr_running + rq->expired->nr_running;
+}
+
+static void enqueue_fair(struct cfs_rq *cfs, struct task *t)
+{
+	struct rb_node **pos, *parent;
+	struct task *curr;
+	int leftmost;
+
+	pos = &cfs->root.root_node;
+	parent = NULL;
+	leftmost = 1;
+
+	while (*pos) {
+		curr = rb_entry(*pos, struct task, sched_node);
+		parent = *pos;
+
+		if (vruntime_before(t->vruntime, curr->vruntime)) {
+			pos = &(*pos)->left;
+		} else {
+			pos = &(*pos)->right;
+			leftmost = 0;
+		}
+	}
+
+	rb_link(&t->sched_node, parent, pos);
+	rb_balance(&cfs->root, &t->sched_node);
+	if (leftmost)
+		cfs->leftmost = &t->sched_node;
+
+	cfs->nr_running++;
+	cfs->load += task_weight(t);
+}
+
+static void dequeue_fair(struct cfs_rq *cfs, struct task *t)
+{
+	if (cfs->leftmost == &t->sched_node)
+		cfs->leftmost = rb_next(&t->sched_node);
+
+	rb_delete(&cfs->root, &t->sched_node);
+	cfs->nr_running--;
+	cfs->load -= task_weight(t);
+}
+
+static __always_inline struct task *cfs_first(struct cfs_rq *cfs)
+{
+	return cfs->leftmost
+	       ? rb_entry(cfs->leftmost, struct task, sched_node)
+	       : NULL;
+}
+
+/*
+ * update_min_vruntime:
+ * Advance the queue's minimum vruntime, which only ever increases,
+ * to the smallest vruntime of any of its tasks, including `curr`.
+ */
+static void update_min_vruntime(struct cfs_rq *cfs, struct task *curr)
+{
+	struct task *first;
+	uint64_t vruntime;
+
+	vruntime = cfs->min_vruntime;
+	first = cfs_first(cfs);
+
+	if (curr && curr->policy == SCHED_NORMAL &&
+	    curr->state == TASK_RUNNING) {
+		vruntime = curr->vruntime;
+		if (first && vruntime_before(first->vruntime, vruntime))
+			vruntime = first->vruntime;
+	} else if (first) {
+		vruntime = first->vruntime;
+	}
+
+	if (vruntime_before(cfs->min_vruntime, vruntime))
+		cfs->min_vruntime = vruntime;
+}
+
+/*
+ * sched_slice:
+ * Amount of real time `t` should run before yielding to another
+ * SCHED_NORMAL task: its weighted share of the scheduling latency.
+ */
+static uint64_t sched_slice(struct cfs_rq *cfs, struct task *t)
+{
+	uint64_t slice;
+
+	slice = SCHED_LATENCY_US * task_weight(t)
+	        / (cfs->load + task_weight(t)) * 1000ULL;
+	return slice < SCHED_MIN_GRAN_NS ? SCHED_MIN_GRAN_NS : slice;
+}
+
+/*
+ * place_task:
+ * Set the vruntime of a SCHED_NORMAL task being added to the queue.
+ * A task which has been sleeping is credited for at most
+ * SCHED_SLEEPER_CREDIT_NS, so that it runs soon after waking without
+ * being able to monopolize the processor.
+ */
+static void place_task(struct cfs_rq *cfs, struct task *t, int new)
+{
+	uint64_t vruntime;
+
+	vruntime = cfs->min_vruntime;
+	if (!new)
+		vruntime -= SCHED_SLEEPER_CREDIT_NS;
+
+	if (new || vruntime_before(t->vruntime, vruntime))
+		t->vruntime = vruntime;
+}
+
+/* put_prev_task: return the running task `t` to the runqueue */
+static void put_prev_task(struct runqueue *rq, struct task *t)
+{
+	t->state = TASK_READY;
+	if (t->policy == SCHED_PRIO) {
+		if (t->time_slice <= 0) {
+			t->time_slice = sched_timeslice(t->priority);
+			enqueue_prio(rq->expired, t);
+		} else {
+			enqueue_prio(rq->active, t);
+		}
+	} else {
+		enqueue_fair(&rq->cfs, t);
+	}
+	rq->nr_running++;
+}
+
+/* pick_next_task: remove and return the next task to run */
+static struct task *pick_next_task(struct runqueue *rq)
+{
+	struct task *t;
+
+	if (prio_nr_running(rq)) {
+		t = pick_next_prio(rq);
+	} else {
+		t = cfs_first(&rq->cfs);
+		dequeue_fair(&rq->cfs, t);
+		t->slice_start = t->sum_exec;
+	}
+	rq->nr_running--;
+
+	return t;
+}
+
+/*
+ * double_rq_lock:
+ * Lock two runqueues, always in the same order to prevent deadlock.
+ * Called with interrupts disabled.
+ */
+static void double_rq_lock(struct runqueue *a, struct runqueue *b)
+{
+	if (a < b) {
+		spin_lock(&a->lock);
+		spin_lock(&b->lock);
+	} else {
+		spin_lock(&b->lock);
+		spin_lock(&a->lock);
+	}
+}
+
+static void double_rq_unlock(struct runqueue *a, struct runqueue *b)
+{
+	spin_unlock(&a->lock);
+	spin_unlock(&b->lock);
+}
+
+/*
+ * migrate_task:
+ * Move queued task `t` from runqueue `src` to `dst`.
+ * Both runqueues must be locked.
+ */
+static void migrate_task(struct runqueue *src, struct prio_array *array,
+                         struct runqueue *dst, struct task *t)
+{
+	if (t->policy == SCHED_PRIO) {
+		dequeue_prio(array, t);
+		enqueue_prio(array == src->active ? dst->active : dst->expired,
+		             t);
+	} else {
+		dequeue_fair(&src->cfs, t);
+		/* preserve the task's lag relative to the queue's minimum */
+		t->vruntime = t->vruntime - src->cfs.min_vruntime
+		              + dst->cfs.min_vruntime;
+		enqueue_fair(&dst->cfs, t);
+	}
+
+	src->nr_running--;
+	dst->nr_running++;
+	t->cpu = dst->cpu;
+}
+
+/* task_can_migrate: return 1 if queued task `t` may be moved to `cpu` */
+static __always_inline int task_can_migrate(struct task *t, int cpu)
+{
+	return !READ_ONCE(t->on_cpu) && cpumask_test_cpu(cpu, &t->cpus_allowed);
+}
+
+/*
+ * find_migratable_task:
+ * Find a task queued on `src` which is allowed to run on `cpu`.
+ * SCHED_NORMAL tasks furthest from running are preferred, followed by
+ * the lowest priority SCHED_PRIO tasks. If a SCHED_PRIO task is returned,
+ * `array` is set to the array it is in.
+ */
+static struct task *find_migratable_task(struct runqueue *src, int cpu,
+                                         struct prio_array **array)
+{
+	struct rb_node *node;
+	struct task *t, *found;
+	struct prio_array *arr[2];
+	int i, prio;
+
+	found = NULL;
+	for (node = rb_first(&src->cfs.root); node; node = rb_next(node)) {
+		t = rb_entry(node, struct task, sched_node);
+		if (task_can_migrate(t, cpu))
+			found = t;
+	}
+	if (found)
+		return found;
+
+	arr[0] = src->expired;
+	arr[1] = src->active;
+	for (i = 0; i < 2; ++i) {
+		for (prio = SCHED_PRIO_LEVELS - 1; prio >= 0; --prio) {
+			if (!test_bit(prio, arr[i]->bitmap))
+				continue;
+			list_for_each_entry(t, &arr[i]->queue[prio], queue) {
+				if (task_can_migrate(t, cpu)) {
+					*array = arr[i];
+					return t;
+				}
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* find_busiest_queue: return the most loaded runqueue other than `rq` */
+static struct runqueue *find_busiest_queue(struct runqueue *rq)
+{
+	struct runqueue *busiest, *other;
+	unsigned int cpu;
+
+	busiest = NULL;
+	for_each_online_cpu(cpu) {
+		other = cpu_rq(cpu);
+		if (other == rq)
+			continue;
+		if (!busiest || READ_ONCE(other->nr_running) >
+		                READ_ONCE(busiest->nr_running))
+			busiest = other;
+	}
+
+	return busiest;
+}
+
+/*
+ * load_balance:
+ * Pull tasks from the busiest runqueue to `rq` until their loads differ
+ * by at most `imbalance`. Return the number of tasks moved.
+ * Called with interrupts disabled and no runqueues locked.
+ */
+static int load_balance(struct runqueue *rq, unsigned int imbalance)
+{
+	struct runqueue *busiest;
+	struct prio_array *array;
+	struct task *t;
+	int moved;
+
+	busiest = find_busiest_queue(rq);
+	if (!busiest)
+		return 0;
+
+	moved = 0;
+	double_rq_lock(rq, busiest);
+	while (busiest->nr_running > rq->nr_running + imbalance) {
+		array = NULL;
+		t = find_migratable_task(busiest, rq->cpu, &array);
+		if (!t)
+			break;
+
+		migrate_task(busiest, array, rq, t);
+		moved++;
+	}
+	double_rq_unlock(rq, busiest);
+
+	return moved;
+}
+
+/*
+ * __schedule:
+ * Select a task to run and switch to it. `preempted` is set when the
+ * current task is being involuntarily preempted rather than yielding.
+ */
+static void __schedule(int preempt, int preempted)
+{
+	struct runqueue *rq;
 	struct task *curr, *next;
+	unsigned long flags;
 
-	if (unlikely(list_empty(&task_queue)))
-		return;
+	/* schedule is never called within an RCU read-side critical section */
+	rcu_note_context_switch();
 
 	/*
 	 * Don't allow current task to be preempted by another
@@ -54,32 +542,372 @@ void schedule(int preempt)
 	if (preempt)
 		irq_disable();
 
+	irq_save(flags);
+	rq = this_rq();
+
+	/* steal a task rather than leave this processor idle */
+	if (!READ_ONCE(rq->nr_running))
+		load_balance(rq, 0);
+
+	spin_lock(&rq->lock);
+	rq->need_resched = 0;
 	curr = current_task();
-	next = list_first_entry(&task_queue, struct task, queue);
 
 	/*
-	 * The current task may be blocked, in which case it should not
-	 * be added to the ready queue.
+	 * With nothing else to run, a runnable task keeps the processor.
+	 * Otherwise, it is handed to the idle task, if there is one.
 	 */
-	if (curr && curr->state == TASK_RUNNING) {
-		curr->state = TASK_READY;
-		list_ins(&task_queue, &curr->queue);
+	if (unlikely(!rq->nr_running) &&
+	    (!rq->idle || curr == rq->idle ||
+	     (curr && curr->state == TASK_RUNNING))) {
+		if (curr) {
+			if (curr->time_slice <= 0)
+				curr->time_slice =
+					sched_timeslice(curr->priority);
+			curr->slice_start = curr->sum_exec;
+		}
+		spin_unlock(&rq->lock);
+		irq_restore(flags);
+		if (preempt)
+			irq_enable();
+		return;
 	}
-	list_del(&next->queue);
 
-	if (preempt) {
+	/*
+	 * The current task may be blocked, in which case it should not
+	 * be added to the ready queue. The exception is a task preempted
+	 * after marking itself blocked but before calling schedule: its
+	 * waker may already have run, so nothing else would wake it. It
+	 * is requeued and runs again as if woken spuriously, rechecking
+	 * its wait condition. A waker which gets to it first requeues it.
+	 */
+	if (curr && curr != rq->idle &&
+	    (curr->state == TASK_RUNNING ||
+	     (preempted && cmpxchg(&curr->state, TASK_BLOCKED,
+	                           TASK_READY) == TASK_BLOCKED)))
+		put_prev_task(rq, curr);
+	next = rq->nr_running ? pick_next_task(rq) : rq->idle;
+	update_min_vruntime(&rq->cfs, NULL);
+	spin_unlock(&rq->lock);
+
+	/* the tick was stopped for the previous task's needs */
+	if (next != curr)
+		tick_nohz_kick(rq->cpu);
+	irq_restore(flags);
+
+	if (next == curr) {
+		curr->state = TASK_RUNNING;
+	} else {
+		if (curr)
+			fpu_switch_out(curr);
 		switch_to_task(next);
+	}
+
+	if (preempt)
 		irq_enable();
+}
+
+/*
+ * schedule: select a task to run and switch to it.
+ * If preempt is 1, interrupts are disabled for the duration of the switch.
+ * Otherwise, the caller must already have disabled them.
+ */
+void schedule(int preempt)
+{
+	__schedule(preempt, 0);
+}
+
+/*
+ * cpu_idle:
+ * Turn the current task into the idle task of the executing processor.
+ * It halts until an interrupt arrives, and yields whenever another task
+ * becomes runnable.
+ */
+__noreturn void cpu_idle(void)
+{
+	struct runqueue *rq;
+
+	sched_set_idle();
+	rq = this_rq();
+
+	while (1) {
+		irq_disable();
+		if (READ_ONCE(rq->nr_running)) {
+			irq_enable();
+			schedule(1);
+		} else {
+			IDLE_HALT();
+			irq_enable();
+		}
+	}
+}
+
+/*
+ * preempt_schedule_irq:
+ * Called with interrupts disabled on return from an interrupt handler.
+ * Switch away from the interrupted task if it is due to be rescheduled
+ * and not running with preemption disabled.
+ */
+void preempt_schedule_irq(void)
+{
+	if (READ_ONCE(this_rq()->need_resched) && preemptible() &&
+	    current_task())
+		__schedule(0, 1);
+}
+
+/*
+ * sched_tick:
+ * Charge the running task for `ticks` timer ticks.
+ * Return nonzero if it should be rescheduled.
+ */
+int sched_tick(unsigned int ticks)
+{
+	struct runqueue *rq;
+	struct task *curr, *first;
+	unsigned long flags;
+
+	irq_save(flags);
+	rq = this_rq();
+
+	if (rq->balance_ticks <= ticks) {
+		rq->balance_ticks = SCHED_BALANCE_INTERVAL;
+		if (load_balance(rq, 1))
+			rq->need_resched = 1;
+	} else {
+		rq->balance_ticks -= ticks;
+	}
+
+	curr = current_task();
+	if (!curr || curr == rq->idle) {
+		irq_restore(flags);
+		return rq->need_resched;
+	}
+
+	spin_lock(&rq->lock);
+	curr->sum_exec += (uint64_t)ticks * TICK_NSEC;
+
+	if (curr->policy == SCHED_PRIO) {
+		curr->time_slice -= ticks;
+		if (curr->time_slice <= 0)
+			rq->need_resched = 1;
+	} else if (prio_nr_running(rq)) {
+		rq->need_resched = 1;
 	} else {
-		this_cpu_write(current_task, next);
-		next->state = TASK_RUNNING;
+		curr->vruntime += (uint64_t)ticks *
+		                  (TICK_NSEC * SCHED_WEIGHT_DEFAULT /
+		                   task_weight(curr));
+		update_min_vruntime(&rq->cfs, curr);
+
+		first = cfs_first(&rq->cfs);
+		if (first && vruntime_before(first->vruntime, curr->vruntime) &&
+		    curr->sum_exec - curr->slice_start >=
+		    sched_slice(&rq->cfs, curr))
+			rq->need_resched = 1;
 	}
+	spin_unlock(&rq->lock);
+	irq_restore(flags);
+
+	return rq->need_resched;
 }
 
-void sched_add(struct task *t)
+/*
+ * sched_next_tick:
+ * Return the number of ticks the executing processor's scheduler can go
+ * without being run, allowing the tick to be stopped. A return of 1 means
+ * that every tick is needed.
+ */
+unsigned int sched_next_tick(void)
+{
+	struct runqueue *rq;
+	struct task *curr;
+	unsigned int next;
+	unsigned long flags;
+
+	irq_save(flags);
+	rq = this_rq();
+	curr = current_task();
+
+	spin_lock(&rq->lock);
+	if (rq->need_resched) {
+		next = 1;
+	} else if (!rq->nr_running) {
+		/* only periodic load balancing remains to be done */
+		next = rq->balance_ticks;
+	} else if (curr && curr->state == TASK_RUNNING &&
+	           curr->policy == SCHED_PRIO && curr->time_slice > 1) {
+		/*
+		 * Any higher priority task would already have requested
+		 * a reschedule, so queued tasks must wait for the running
+		 * task's slice to expire.
+		 */
+		next = min((unsigned int)curr->time_slice, rq->balance_ticks);
+	} else {
+		next = 1;
+	}
+	spin_unlock(&rq->lock);
+	irq_restore(flags);
+
+	return next;
+}
+
+/*
+ * select_task_rq:
+ * Choose the runqueue on which to place waking task `t`. The processor
+ * on which it last ran is preferred, as its cache may still hold the
+ * task's data, unless the waking processor has fewer tasks queued.
+ */
+static struct runqueue *select_task_rq(struct task *t)
 {
+	struct runqueue *prev, *local;
+	unsigned int cpu;
+
+	local = this_rq();
+	prev = cpu_online(t->cpu) && cpumask_test_cpu(t->cpu, &t->cpus_allowed)
+	       ? cpu_rq(t->cpu) : NULL;
+
+	if (!cpumask_test_cpu(local->cpu, &t->cpus_allowed)) {
+		if (prev)
+			return prev;
+
+		for_each_online_cpu(cpu) {
+			if (cpumask_test_cpu(cpu, &t->cpus_allowed))
+				return cpu_rq(cpu);
+		}
+		return local;
+	}
+
+	if (prev && READ_ONCE(prev->nr_running) <=
+	            READ_ONCE(local->nr_running))
+		return prev;
+
+	return local;
+}
+
+/*
+ * sched_wake:
+ * Make `t` runnable, preempting the task running on its new processor
+ * at that processor's next tick if `t` should run before it.
+ */
+static void sched_wake(struct task *t, int new)
+{
+	struct runqueue *rq;
+	struct task *curr;
+	unsigned long flags;
+
+	irq_save(flags);
+	/* a task still switching out of its processor must stay there */
+	if (READ_ONCE(t->on_cpu))
+		rq = cpu_rq(t->cpu);
+	else
+		rq = select_task_rq(t);
+
+	spin_lock(&rq->lock);
 	t->state = TASK_READY;
-	list_ins(&task_queue, &t->queue);
+	t->cpu = rq->cpu;
+	curr = rq_curr(rq);
+	if (curr == rq->idle)
+		rq->need_resched = 1;
+
+	if (t->policy == SCHED_PRIO) {
+		if (t->time_slice <= 0)
+			t->time_slice = sched_timeslice(t->priority);
+		enqueue_prio(rq->active, t);
+
+		if (curr && (curr->policy != SCHED_PRIO ||
+		             t->priority < curr->priority))
+			rq->need_resched = 1;
+	} else {
+		place_task(&rq->cfs, t, new);
+		enqueue_fair(&rq->cfs, t);
+
+		if (curr && curr->policy == SCHED_NORMAL &&
+		    vruntime_before(t->vruntime + SCHED_WAKEUP_GRAN_NS,
+		                    curr->vruntime))
+			rq->need_resched = 1;
+	}
+	rq->nr_running++;
+	spin_unlock(&rq->lock);
+
+	/* the processor's tick may have been stopped while it was idle */
+	tick_nohz_kick(rq->cpu);
+	irq_restore(flags);
+}
+
+void sched_add(struct task *t)
+{
+	sched_wake(t, 1);
+}
+
+/*
+ * sched_set_idle:
+ * Make the current task the idle task of the executing processor.
+ * It is removed from both scheduling policies and pinned to the processor.
+ */
+void sched_set_idle(void)
+{
+	struct runqueue *rq;
+	struct task *curr;
+	unsigned long flags;
+
+	irq_save(flags);
+	rq = this_rq();
+	curr = current_task();
+
+	spin_lock(&rq->lock);
+	cpumask_clear(&curr->cpus_allowed);
+	cpumask_set_cpu(rq->cpu, &curr->cpus_allowed);
+	curr->cpu = rq->cpu;
+	rq->idle = curr;
+	spin_unlock(&rq->lock);
+
+	irq_restore(flags);
+}
+
+/*
+ * sched_setscheduler:
+ * Set the scheduling policy and priority of `t`, which must either not
+ * have been started yet or be the current task; a task sitting in a
+ * runqueue cannot be changed.
+ */
+int sched_setscheduler(struct task *t, int policy, int prio)
+{
+	struct runqueue *rq;
+	unsigned long flags;
+
+	if (policy != SCHED_NORMAL && policy != SCHED_PRIO)
+		return EINVAL;
+	if (prio < 0 || prio >= SCHED_PRIO_LEVELS)
+		return EINVAL;
+
+	if (t->state == TASK_STOPPED) {
+		t->policy = policy;
+		t->priority = prio;
+		t->time_slice = 0;
+		return 0;
+	}
+
+	if (t != current_task())
+		return EBUSY;
+
+	irq_save(flags);
+	rq = this_rq();
+	spin_lock(&rq->lock);
+
+	t->policy = policy;
+	t->priority = prio;
+	if (policy == SCHED_PRIO) {
+		t->time_slice = sched_timeslice(prio);
+	} else {
+		place_task(&rq->cfs, t, 1);
+		t->slice_start = t->sum_exec;
+	}
+	/* a higher priority task may now be waiting */
+	rq->need_resched = 1;
+
+	spin_unlock(&rq->lock);
+	irq_restore(flags);
+
+	return 0;
 }
 
 /*
@@ -87,10 +915,14 @@ void sched_add(struct task *t)
  * Called when a resource held by `t` becomes available.
  * Scheduler decides whether to preempt the current thread and run `t`
  * or to add `t` to the queue of waiting threads.
+ * Return 1 if `t` was woken, or 0 if it was not blocked.
  */
-void sched_unblock(struct task *t)
+int sched_unblock(struct task *t)
 {
-	/* TODO: since we don't have priorities yet, just add to wait queue */
-	t->state = TASK_READY;
-	list_ins(&task_queue, &t->queue);
+	/* a task may have several wakers; only the first may enqueue it */
+	if (cmpxchg(&t->state, TASK_BLOCKED, TASK_READY) != TASK_BLOCKED)
+		return 0;
+
+	sched_wake(t, 0);
+	return 1;
 }
@@ -0,0 +1,180 @@
+/*
+ * kernel/softirq.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/bitops.h>
+#include <radix/irq.h>
+#include <radix/percpu.h>
+#include <radix/preempt.h>
+#include <radix/softirq.h>
+#include <radix/workqueue.h>
+
+/*
+ * Maximum number of times pending softirqs are rerun on a single interrupt
+ * exit before the rest are handed to the processor's worker thread.
+ */
+#define MAX_SOFTIRQ_RESTART 10
+
+static void (*softirq_vec[NR_SOFTIRQS])(void);
+
+/* only modified by the processor which owns it */
+static DEFINE_PER_CPU(unsigned long, pending_softirqs);
+
+static DEFINE_PER_CPU(struct llist_head, tasklet_list);
+
+static void softirq_work_fn(struct work_struct *work);
+static DEFINE_PER_CPU(struct work_struct, softirq_work);
+
+/* open_softirq: set the function run for softirq `nr` */
+void open_softirq(unsigned int nr, void (*action)(void))
+{
+	if (nr < NR_SOFTIRQS)
+		softirq_vec[nr] = action;
+}
+
+/*
+ * raise_softirq:
+ * Mark softirq `nr` pending on the executing processor.
+ * Must be called from an interrupt handler or with preemption disabled.
+ */
+void raise_softirq(unsigned int nr)
+{
+	/* a single btsl cannot be split by an interrupt on this processor */
+	__set_bit(nr, raw_cpu_ptr(&pending_softirqs));
+}
+
+int softirq_pending(void)
+{
+	return this_cpu_read(pending_softirqs) != 0;
+}
+
+/*
+ * do_softirq:
+ * Run the executing processor's pending softirqs. Called with interrupts
+ * enabled on return from a hardware interrupt. Nothing is run if the
+ * interrupted context has bottom halves disabled, or is itself running
+ * softirqs; they are run later by local_bh_enable or the outer do_softirq.
+ */
+void do_softirq(void)
+{
+	unsigned long pending, flags;
+	unsigned int nr;
+	int restart;
+
+	if (in_softirq())
+		return;
+
+	local_bh_disable();
+
+	restart = MAX_SOFTIRQ_RESTART;
+	do {
+		irq_save(flags);
+		pending = this_cpu_read(pending_softirqs);
+		this_cpu_write(pending_softirqs, 0);
+		irq_restore(flags);
+
+		for_each_set_bit(nr, &pending, NR_SOFTIRQS) {
+			if (softirq_vec[nr])
+				softirq_vec[nr]();
+		}
+	} while (softirq_pending() && --restart);
+
+	/* don't starve tasks under a flood of softirqs */
+	if (softirq_pending())
+		schedule_work(raw_cpu_ptr(&softirq_work));
+
+	barrier();
+	this_cpu_sub(preempt_count, SOFTIRQ_OFFSET);
+}
+
+/*
+ * local_bh_enable:
+ * Allow softirqs to run again on the executing processor. If this ends
+ * the outermost local_bh_disable, softirqs raised in the meantime are run.
+ */
+void local_bh_enable(void)
+{
+	barrier();
+	this_cpu_sub(preempt_count, SOFTIRQ_OFFSET);
+
+	if (!in_softirq() && !in_irq() && irq_active() && softirq_pending())
+		do_softirq();
+}
+
+static void softirq_work_fn(struct work_struct *work)
+{
+	(void)work;
+
+	do_softirq();
+}
+
+/*
+ * tasklet_schedule:
+ * Schedule `t` to run on the executing processor, unless it is already
+ * scheduled. It runs on the next return from an interrupt or, if not
+ * called from an interrupt handler, from the processor's worker thread.
+ */
+void tasklet_schedule(struct tasklet *t)
+{
+	if (test_and_set_bit(TASKLET_STATE_SCHED, &t->state))
+		return;
+
+	preempt_disable();
+	llist_add(&t->node, raw_cpu_ptr(&tasklet_list));
+	raise_softirq(TASKLET_SOFTIRQ);
+
+	/* there may not be another interrupt for some time */
+	if (!in_irq())
+		schedule_work(raw_cpu_ptr(&softirq_work));
+	preempt_enable();
+}
+
+static void tasklet_action(void)
+{
+	struct llist_node *list;
+	struct tasklet *t;
+
+	list = llist_del_all(raw_cpu_ptr(&tasklet_list));
+	list = llist_reverse_order(list);
+
+	while (list) {
+		t = llist_entry(list, struct tasklet, node);
+		list = list->next;
+
+		/* running on another processor; try again later */
+		if (test_and_set_bit(TASKLET_STATE_RUN, &t->state)) {
+			llist_add(&t->node, raw_cpu_ptr(&tasklet_list));
+			raise_softirq(TASKLET_SOFTIRQ);
+			continue;
+		}
+
+		/* allow the tasklet to be rescheduled while it runs */
+		clear_bit(TASKLET_STATE_SCHED, &t->state);
+		t->func(t->data);
+		clear_bit(TASKLET_STATE_RUN, &t->state);
+	}
+}
+
+void softirq_init(void)
+{
+	unsigned int cpu;
+
+	for_each_online_cpu(cpu)
+		work_init(per_cpu_ptr(&softirq_work, cpu), softirq_work_fn);
+
+	open_softirq(TASKLET_SOFTIRQ, tasklet_action);
+}
@@ -17,8 +17,10 @@
  */
 
 #include <radix/error.h>
+#include <radix/fpu.h>
 #include <radix/kernel.h>
 #include <radix/kthread.h>
+#include <radix/rcupdate.h>
 #include <radix/sched.h>
 #include <radix/slab.h>
 #include <radix/tasking.h>
@@ -36,7 +38,7 @@ void tasking_init(void)
 	task_cache = create_cache("task_cache", sizeof (struct task),
 	                          SLAB_MIN_ALIGN,
 	                          SLAB_HW_CACHE_ALIGN | SLAB_PANIC,
-	                          task_init, task_init);
+	                          task_init, NULL);
 	sched_init();
 
 	/*
@@ -49,11 +51,10 @@ void tasking_init(void)
 		panic("failed to allocate task for main kernel thread: %s\n",
 		      strerror(ERR_VAL(curr)));
 	}
+	task_reset(curr);
 	curr->state = TASK_RUNNING;
-	curr->cmdline = kmalloc(sizeof (*curr->cmdline) << 1);
-	curr->cmdline[0] = kmalloc(KTHREAD_NAME_LEN);
-	strcpy(curr->cmdline[0], "kernel_boot_thread");
-	curr->cmdline[1] = NULL;
+	curr->on_cpu = 1;
+	strcpy(curr->name, "kernel_boot_thread");
 
 	this_cpu_write(current_task, curr);
 }
@@ -61,19 +62,66 @@ void tasking_init(void)
 /* Allocate and initialize a new task struct for a kthread. */
 struct task *kthread_task(void)
 {
-	return alloc_cache(task_cache);
+	struct task *task;
+
+	task = alloc_cache(task_cache);
+	if (!IS_ERR(task)) {
+		task_reset(task);
+		task->stack = NULL;
+	}
+
+	return task;
+}
+
+/*
+ * task_reset:
+ * Reset the scheduling and identity state of `task` so that it can run
+ * a new thread. Its stack and FPU state, which are managed separately,
+ * are left untouched.
+ */
+void task_reset(struct task *task)
+{
+	task->state = TASK_STOPPED;
+	task->on_cpu = 0;
+	task->priority = SCHED_PRIO_DEFAULT;
+	task->exit_code = 0;
+	task->interrupt_depth = 0;
+	task->pid = 0;
+	task->uid = 0;
+	task->gid = 0;
+	task->umask = 0;
+	task->vmm = NULL;
+	task->cwd = NULL;
+	task->name[0] = '\0';
+	task->cpu = 0;
+	cpumask_setall(&task->cpus_allowed);
+	task->policy = SCHED_NORMAL;
+	task->time_slice = 0;
+	task->vruntime = 0;
+	task->sum_exec = 0;
+	task->slice_start = 0;
+	list_init(&task->queue);
+	rb_init(&task->sched_node);
 }
 
+static void task_free_rcu(struct rcu_head *head)
+{
+	free_cache(task_cache, container_of(head, struct task, rcu));
+}
+
+/*
+ * task_free:
+ * Destroy `task`. Its memory is only released after an RCU grace period,
+ * as lockless readers such as mutex spinners may still be looking at it.
+ */
 void task_free(struct task *task)
 {
-	free_cache(task_cache, task);
+	fpu_task_exit(task);
+	call_rcu(&task->rcu, task_free_rcu);
 }
 
+/* slab constructor: runs once when the object's slab is created */
 static void task_init(void *t)
 {
-	struct task *task;
-
-	task = t;
-	memset(task, 0, sizeof *task);
-	list_init(&task->queue);
+	memset(t, 0, sizeof (struct task));
 }
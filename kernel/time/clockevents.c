@@ -0,0 +1,140 @@
+/*
+ * kernel/time/clockevents.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/clockevent.h>
+#include <radix/clocksource.h>
+#include <radix/error.h>
+#include <radix/irq.h>
+#include <radix/kernel.h>
+#include <radix/math64.h>
+#include <radix/smp.h>
+#include <radix/spinlock.h>
+#include <radix/tick.h>
+#include <radix/time.h>
+
+static struct list clockevent_devices = LIST_INIT(clockevent_devices);
+static spinlock_t clockevents_lock = SPINLOCK_INIT;
+
+/*
+ * cycles_to_ns:
+ * Convert `cycles` of a device running at `freq` cycles per
+ * `unit_ns` nanoseconds to nanoseconds.
+ */
+static uint64_t cycles_to_ns(unsigned long cycles, uint32_t unit_ns,
+                             uint32_t freq)
+{
+	return div_u64((uint64_t)cycles * unit_ns, freq);
+}
+
+static void __clockevents_config(struct clock_event_device *dev,
+                                 uint32_t unit_ns, uint32_t freq,
+                                 unsigned long min_delta,
+                                 unsigned long max_delta)
+{
+	clocks_calc_mult_shift(&dev->mult, &dev->shift, unit_ns, freq,
+	                       max(max_delta / freq, 1UL));
+	dev->max_delta = max_delta;
+	dev->min_delta_ns = cycles_to_ns(min_delta, unit_ns, freq);
+	dev->max_delta_ns = cycles_to_ns(max_delta, unit_ns, freq);
+}
+
+/*
+ * clockevents_config:
+ * Set up the nanosecond to cycle conversion of `dev`, which runs at `freq`
+ * Hz and can be programmed with intervals of `min_delta` to `max_delta`
+ * cycles.
+ */
+void clockevents_config(struct clock_event_device *dev, uint32_t freq,
+                        unsigned long min_delta, unsigned long max_delta)
+{
+	__clockevents_config(dev, NSEC_PER_SEC, freq, min_delta, max_delta);
+}
+
+/*
+ * clockevents_config_khz:
+ * As clockevents_config, for a device running at `khz` kHz. This allows
+ * devices clocked at over 4 GHz to be described.
+ */
+void clockevents_config_khz(struct clock_event_device *dev, uint32_t khz,
+                            unsigned long min_delta, unsigned long max_delta)
+{
+	__clockevents_config(dev, NSEC_PER_MSEC, khz, min_delta, max_delta);
+}
+
+/*
+ * clockevents_register_device:
+ * Make clock event device `dev` available to the kernel.
+ * Must be called on the processor which `dev` interrupts.
+ */
+void clockevents_register_device(struct clock_event_device *dev)
+{
+	unsigned long flags;
+
+	dev->mode = CLOCK_EVT_MODE_UNUSED;
+
+	spin_lock_irqsave(&clockevents_lock, flags);
+	list_ins(&clockevent_devices, &dev->list);
+	spin_unlock_irqrestore(&clockevents_lock, flags);
+
+	tick_check_new_device(dev);
+}
+
+void clockevents_set_mode(struct clock_event_device *dev, unsigned int mode)
+{
+	if (dev->mode == mode)
+		return;
+
+	dev->set_mode(dev, mode);
+	dev->mode = mode;
+}
+
+/* Number of doubled delays to try before falling back to the maximum. */
+#define CLOCKEVENTS_MAX_RETRIES 8
+
+/*
+ * clockevents_program_event:
+ * Program `dev` to raise an interrupt in `delta_ns` nanoseconds.
+ * The delay is clamped to the range supported by the device. If the
+ * device reports that the event was already in the past by the time it
+ * was programmed, a longer delay is retried, up to the device's maximum.
+ * Return ETIME if even that could not be programmed.
+ */
+int clockevents_program_event(struct clock_event_device *dev,
+                              uint64_t delta_ns)
+{
+	unsigned long cycles;
+	int i;
+
+	delta_ns = min(delta_ns, dev->max_delta_ns);
+	delta_ns = max(delta_ns, dev->min_delta_ns);
+
+	cycles = mul_u64_u32_shr(delta_ns, dev->mult, dev->shift);
+	cycles = min(cycles, dev->max_delta);
+
+	for (i = 0; dev->set_next_event(dev, cycles) == ETIME; ++i) {
+		if (cycles == dev->max_delta)
+			return ETIME;
+
+		if (i == CLOCKEVENTS_MAX_RETRIES || cycles > dev->max_delta / 2)
+			cycles = dev->max_delta;
+		else
+			cycles <<= 1;
+	}
+
+	return 0;
+}
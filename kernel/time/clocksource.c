@@ -0,0 +1,111 @@
+/*
+ * kernel/time/clocksource.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/clocksource.h>
+#include <radix/math64.h>
+#include <radix/spinlock.h>
+#include <radix/time.h>
+
+#include "timekeeping.h"
+
+static struct list clocksources = LIST_INIT(clocksources);
+static spinlock_t clocksource_lock = SPINLOCK_INIT;
+
+/*
+ * clocks_calc_mult_shift:
+ * Calculate a multiplier and shift which convert from frequency `from`
+ * to frequency `to` as (x * mult) >> shift. The largest shift is chosen
+ * for which `maxsec` seconds worth of `from` cycles can be converted
+ * without overflowing 64 bits.
+ */
+void clocks_calc_mult_shift(uint32_t *mult, uint32_t *shift,
+                            uint32_t from, uint32_t to, uint32_t maxsec)
+{
+	uint64_t tmp;
+	uint32_t sft, sftacc;
+
+	/* number of bits available to the multiplier */
+	tmp = ((uint64_t)maxsec * from) >> 32;
+	for (sftacc = 32; tmp; --sftacc)
+		tmp >>= 1;
+
+	for (sft = 32; sft > 0; --sft) {
+		tmp = (uint64_t)to << sft;
+		tmp = div_u64(tmp + from / 2, from);
+		if (!(tmp >> sftacc))
+			break;
+	}
+
+	*mult = (uint32_t)tmp;
+	*shift = sft;
+}
+
+/*
+ * __clocksource_config:
+ * Set up the cycle to nanosecond conversion of a clocksource which runs
+ * at `freq` cycles per `unit_ns` nanoseconds.
+ */
+static void __clocksource_config(struct clocksource *cs, uint32_t unit_ns,
+                                 uint32_t freq)
+{
+	/* allow the tick to be stopped for minutes between clock reads */
+	clocks_calc_mult_shift(&cs->mult, &cs->shift, freq, unit_ns,
+	                       600 * (NSEC_PER_SEC / unit_ns));
+}
+
+/*
+ * clocksource_config:
+ * Set up the cycle to nanosecond conversion of a `freq` Hz clocksource.
+ */
+void clocksource_config(struct clocksource *cs, uint32_t freq)
+{
+	__clocksource_config(cs, NSEC_PER_SEC, freq);
+}
+
+/*
+ * clocksource_config_khz:
+ * As clocksource_config, for a clocksource running at `khz` kHz. This
+ * allows counters clocked at over 4 GHz to be described.
+ */
+void clocksource_config_khz(struct clocksource *cs, uint32_t khz)
+{
+	__clocksource_config(cs, NSEC_PER_MSEC, khz);
+}
+
+/*
+ * clocksource_register:
+ * Make `cs` available, and switch timekeeping to it
+ * if it is better than the current clocksource.
+ */
+void clocksource_register(struct clocksource *cs)
+{
+	struct clocksource *best, *c;
+	unsigned long flags;
+
+	spin_lock_irqsave(&clocksource_lock, flags);
+	list_ins(&clocksources, &cs->list);
+
+	best = cs;
+	list_for_each_entry(c, &clocksources, list) {
+		if (c->rating > best->rating)
+			best = c;
+	}
+	spin_unlock_irqrestore(&clocksource_lock, flags);
+
+	timekeeping_set_clock(best);
+}
@@ -0,0 +1,221 @@
+/*
+ * kernel/time/hrtimer.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/cpu.h>
+#include <radix/error.h>
+#include <radix/hrtimer.h>
+#include <radix/irq.h>
+#include <radix/percpu.h>
+#include <radix/spinlock.h>
+#include <radix/tick.h>
+
+/*
+ * Pending hrtimers are kept in a red-black tree on each processor, ordered
+ * by expiry time, with the first timer cached. While the time can be read
+ * at sub-tick resolution, the processor's tick device is programmed to
+ * interrupt when the first timer expires. Otherwise, hrtimers are run from
+ * the tick, with tick resolution.
+ */
+struct hrtimer_base {
+	spinlock_t              lock;
+	struct rb_root          root;
+	struct hrtimer          *first;
+};
+
+static DEFINE_PER_CPU(struct hrtimer_base, hrtimer_bases);
+
+/*
+ * enqueue_hrtimer:
+ * Insert `timer` into `base`. Return 1 if it is now the first timer.
+ */
+static int enqueue_hrtimer(struct hrtimer_base *base, struct hrtimer *timer)
+{
+	struct rb_node **pos, *parent;
+	struct hrtimer *curr;
+	int leftmost;
+
+	pos = &base->root.root_node;
+	parent = NULL;
+	leftmost = 1;
+
+	while (*pos) {
+		curr = rb_entry(*pos, struct hrtimer, node);
+		parent = *pos;
+
+		if (timer->expires < curr->expires) {
+			pos = &(*pos)->left;
+		} else {
+			pos = &(*pos)->right;
+			leftmost = 0;
+		}
+	}
+
+	rb_link(&timer->node, parent, pos);
+	rb_balance(&base->root, &timer->node);
+	timer->base = base;
+
+	if (leftmost)
+		base->first = timer;
+
+	return leftmost;
+}
+
+static void dequeue_hrtimer(struct hrtimer_base *base, struct hrtimer *timer)
+{
+	struct rb_node *next;
+
+	if (base->first == timer) {
+		next = rb_next(&timer->node);
+		base->first = next ? rb_entry(next, struct hrtimer, node) : NULL;
+	}
+
+	rb_delete(&base->root, &timer->node);
+	rb_init(&timer->node);
+	WRITE_ONCE(timer->base, NULL);
+}
+
+/*
+ * hrtimer_start:
+ * Start `timer` on the executing processor, to expire at absolute time
+ * `expires`. If the timer is already pending, it is restarted.
+ * Returns 1 if the timer was pending.
+ */
+int hrtimer_start(struct hrtimer *timer, ktime_t expires)
+{
+	struct hrtimer_base *base;
+	unsigned long flags;
+	int first, pending;
+
+	irq_save(flags);
+	base = raw_cpu_ptr(&hrtimer_bases);
+	pending = 0;
+
+	/*
+	 * The timer may be started again by another processor between
+	 * cancelling it and taking the base lock, so check that it is still
+	 * inactive once the lock is held.
+	 */
+	while (1) {
+		pending |= hrtimer_cancel(timer);
+		spin_lock(&base->lock);
+		if (!timer->base)
+			break;
+		spin_unlock(&base->lock);
+	}
+
+	timer->expires = expires;
+	first = enqueue_hrtimer(base, timer);
+	spin_unlock(&base->lock);
+
+	if (first)
+		tick_hrtimer_update();
+	irq_restore(flags);
+
+	return pending;
+}
+
+/*
+ * hrtimer_cancel:
+ * Stop `timer` if it is pending. Returns 1 if it was pending.
+ * Does not wait for the timer's function if it is already running.
+ */
+int hrtimer_cancel(struct hrtimer *timer)
+{
+	struct hrtimer_base *base;
+	unsigned long flags;
+
+	irq_save(flags);
+	while ((base = READ_ONCE(timer->base))) {
+		spin_lock(&base->lock);
+		if (timer->base == base) {
+			dequeue_hrtimer(base, timer);
+			spin_unlock(&base->lock);
+			irq_restore(flags);
+			return 1;
+		}
+		spin_unlock(&base->lock);
+	}
+	irq_restore(flags);
+
+	return 0;
+}
+
+/*
+ * hrtimer_run_queues:
+ * Run the executing processor's hrtimers which have expired by `now`.
+ * Called from its tick handler.
+ */
+void hrtimer_run_queues(uint64_t now)
+{
+	struct hrtimer_base *base;
+	struct hrtimer *timer;
+	unsigned long flags;
+	int ret;
+
+	irq_save(flags);
+	base = raw_cpu_ptr(&hrtimer_bases);
+	spin_lock(&base->lock);
+
+	while ((timer = base->first) && (uint64_t)timer->expires <= now) {
+		dequeue_hrtimer(base, timer);
+
+		spin_unlock(&base->lock);
+		ret = timer->function(timer);
+		spin_lock(&base->lock);
+
+		if (ret == HRTIMER_RESTART && !timer->base)
+			enqueue_hrtimer(base, timer);
+	}
+
+	spin_unlock(&base->lock);
+	irq_restore(flags);
+}
+
+/*
+ * hrtimer_next_expiry:
+ * Return the expiry time of the executing processor's first hrtimer,
+ * or HRTIMER_NONE if it has none.
+ */
+uint64_t hrtimer_next_expiry(void)
+{
+	struct hrtimer_base *base;
+	struct hrtimer *first;
+
+	base = raw_cpu_ptr(&hrtimer_bases);
+	first = READ_ONCE(base->first);
+
+	return first ? (uint64_t)first->expires : HRTIMER_NONE;
+}
+
+int hrtimer_pending(void)
+{
+	return READ_ONCE(raw_cpu_ptr(&hrtimer_bases)->first) != NULL;
+}
+
+void hrtimers_init(void)
+{
+	struct hrtimer_base *base;
+	int cpu;
+
+	for (cpu = 0; cpu < (int)possible_cpus(); ++cpu) {
+		base = per_cpu_ptr(&hrtimer_bases, cpu);
+		spin_init(&base->lock);
+		base->root = RB_ROOT;
+		base->first = NULL;
+	}
+}
@@ -0,0 +1,247 @@
+/*
+ * kernel/time/tick.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/clockevent.h>
+#include <radix/error.h>
+#include <radix/hrtimer.h>
+#include <radix/irq.h>
+#include <radix/kernel.h>
+#include <radix/ktime.h>
+#include <radix/math64.h>
+#include <radix/percpu.h>
+#include <radix/sched.h>
+#include <radix/smp.h>
+#include <radix/tick.h>
+#include <radix/timer.h>
+
+#include "timekeeping.h"
+
+/*
+ * Each processor's scheduler tick is driven by the best clock event device
+ * which interrupts it.
+ *
+ * While the scheduler needs to run every tick, the device runs in periodic
+ * mode, or emulates it with a one-shot event each tick. When the processor
+ * is idle or its running task cannot be preempted for some time, the tick
+ * is stopped, and a single one-shot event is programmed for the next time
+ * the scheduler or a timer has work to do. The ticks which elapse in the
+ * meantime are charged when that event fires.
+ *
+ * If an hrtimer expires before the next tick is due, and the time can be
+ * read at a finer resolution than ticks, the device is programmed for the
+ * hrtimer instead. Such an event runs hrtimers only.
+ */
+struct tick_device {
+	struct clock_event_device       *evtdev;
+	int                             stopped;
+	unsigned int                    programmed;
+	unsigned int                    max_ticks;
+	uint64_t                        tick_due;
+	int                             hres;
+};
+
+static DEFINE_PER_CPU(struct tick_device, tick_device);
+
+/* Processor responsible for advancing the time. */
+static int tick_do_timer_cpu = -1;
+
+/*
+ * tick_program_event:
+ * Program the one-shot event of `td` for its next tick,
+ * or for the first hrtimer if that expires sooner.
+ */
+static void tick_program_event(struct tick_device *td, uint64_t now)
+{
+	uint64_t expires, delta;
+
+	delta = td->tick_due > now ? td->tick_due - now : 0;
+	td->hres = 0;
+
+	if (timekeeping_continuous()) {
+		expires = hrtimer_next_expiry();
+		if (expires < td->tick_due) {
+			delta = expires > now ? expires - now : 0;
+			td->hres = 1;
+		}
+	}
+
+	clockevents_program_event(td->evtdev, delta);
+}
+
+/*
+ * tick_program:
+ * Stop the tick if neither the scheduler nor any timer needs to run for
+ * more than one tick, or restart it if they do.
+ */
+static void tick_program(struct tick_device *td)
+{
+	struct clock_event_device *dev;
+	unsigned int next;
+	uint64_t now;
+
+	dev = td->evtdev;
+	next = min(sched_next_tick(), timer_next_tick());
+	next = max(min(next, td->max_ticks), 1U);
+
+	if (next == 1 && (dev->features & CLOCK_EVT_FEAT_PERIODIC) &&
+	    !(timekeeping_continuous() && hrtimer_pending())) {
+		clockevents_set_mode(dev, CLOCK_EVT_MODE_PERIODIC);
+		td->stopped = 0;
+		return;
+	}
+
+	now = ktime_get_ns();
+	clockevents_set_mode(dev, CLOCK_EVT_MODE_ONESHOT);
+	td->programmed = next;
+	td->stopped = next > 1;
+	td->tick_due = now + (uint64_t)next * TICK_NSEC;
+	tick_program_event(td, now);
+}
+
+/*
+ * tick_handle_event:
+ * Event handler of tick devices. Runs expired timers and charges the
+ * elapsed ticks to the scheduler.
+ */
+static void tick_handle_event(struct clock_event_device *dev, struct regs *r)
+{
+	struct tick_device *td;
+	unsigned int ticks;
+	uint64_t now;
+
+	(void)r;
+
+	td = raw_cpu_ptr(&tick_device);
+	if (dev->mode == CLOCK_EVT_MODE_ONESHOT && td->hres) {
+		now = ktime_get_ns();
+		if (now < td->tick_due) {
+			hrtimer_run_queues(now);
+			tick_program_event(td, ktime_get_ns());
+			return;
+		}
+	}
+
+	ticks = 1;
+	if (dev->mode == CLOCK_EVT_MODE_ONESHOT)
+		ticks = max(td->programmed, 1U);
+	td->programmed = 0;
+	td->stopped = 0;
+
+	if (dev->cpu == tick_do_timer_cpu)
+		timekeeping_tick(ticks);
+
+	hrtimer_run_queues(ktime_get_ns());
+	timers_run();
+
+	/* a task switch, if due, happens on return from the interrupt */
+	sched_tick(ticks);
+
+	tick_program(td);
+}
+
+/*
+ * tick_check_new_device:
+ * Use newly registered clock event device `dev` to drive the executing
+ * processor's tick if it is better than the current one.
+ */
+int tick_check_new_device(struct clock_event_device *dev)
+{
+	struct tick_device *td;
+	struct clock_event_device *curr;
+	unsigned long flags;
+
+	if (!(dev->features & (CLOCK_EVT_FEAT_PERIODIC |
+	                       CLOCK_EVT_FEAT_ONESHOT)))
+		return EINVAL;
+
+	irq_save(flags);
+	td = raw_cpu_ptr(&tick_device);
+	curr = td->evtdev;
+
+	if (dev->cpu != processor_id() ||
+	    (curr && curr->rating >= dev->rating)) {
+		irq_restore(flags);
+		return EBUSY;
+	}
+
+	if (curr) {
+		clockevents_set_mode(curr, CLOCK_EVT_MODE_SHUTDOWN);
+		curr->event_handler = NULL;
+	}
+
+	td->evtdev = dev;
+	td->max_ticks = 1;
+	if (dev->features & CLOCK_EVT_FEAT_ONESHOT)
+		td->max_ticks = div_u64(dev->max_delta_ns, TICK_NSEC);
+
+	if (tick_do_timer_cpu == -1)
+		tick_do_timer_cpu = dev->cpu;
+
+	dev->event_handler = tick_handle_event;
+	tick_program(td);
+	irq_restore(flags);
+
+	return 0;
+}
+
+/*
+ * tick_nohz_kick:
+ * Restart the tick on processor `cpu` if it is stopped, as the scheduler
+ * or a timer has new work to do there. Without interprocessor interrupts,
+ * a remote processor's tick cannot be restarted; it notices the work when
+ * its own one-shot event fires.
+ *
+ * The ticks which elapsed since the tick was stopped are not charged.
+ */
+void tick_nohz_kick(int cpu)
+{
+	struct tick_device *td;
+	unsigned long flags;
+
+	irq_save(flags);
+	if (cpu == processor_id()) {
+		td = raw_cpu_ptr(&tick_device);
+		if (td->evtdev && td->stopped)
+			tick_program(td);
+	}
+	irq_restore(flags);
+}
+
+/*
+ * tick_hrtimer_update:
+ * Reprogram the executing processor's tick device after
+ * the first hrtimer on the processor has changed.
+ */
+void tick_hrtimer_update(void)
+{
+	struct tick_device *td;
+	unsigned long flags;
+
+	if (!timekeeping_continuous())
+		return;
+
+	irq_save(flags);
+	td = raw_cpu_ptr(&tick_device);
+	if (td->evtdev) {
+		if (td->evtdev->mode == CLOCK_EVT_MODE_PERIODIC)
+			tick_program(td);
+		else
+			tick_program_event(td, ktime_get_ns());
+	}
+	irq_restore(flags);
+}
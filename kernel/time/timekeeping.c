@@ -0,0 +1,178 @@
+/*
+ * kernel/time/timekeeping.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/clocksource.h>
+#include <radix/jiffies.h>
+#include <radix/ktime.h>
+#include <radix/math64.h>
+#include <radix/seqlock.h>
+
+#include "timekeeping.h"
+
+/*
+ * The time since boot is kept as a nanosecond base, accumulated up to the
+ * clocksource reading `cycle_last`, to which the cycles elapsed since then
+ * are added on each read. The base is advanced on every tick, so that the
+ * elapsed cycles never grow large enough to overflow their conversion.
+ *
+ * Updates are made under a seqlock, so reads never block.
+ */
+struct timekeeper {
+	seqlock_t               lock;
+	struct clocksource      *clock;
+	uint64_t                cycle_last;
+	uint64_t                base_ns;
+	uint64_t                jiffies_64;
+};
+
+static struct timekeeper tk;
+
+volatile unsigned long jiffies;
+
+static uint64_t jiffies_read(struct clocksource *cs)
+{
+	(void)cs;
+
+	return tk.jiffies_64;
+}
+
+/*
+ * The jiffies clocksource counts ticks. It is used until a better
+ * clocksource is registered, and has only tick resolution.
+ */
+static struct clocksource clocksource_jiffies = {
+	.name   = "jiffies",
+	.rating = 1,
+	.read   = jiffies_read,
+	.mask   = CLOCKSOURCE_MASK(64),
+	.mult   = TICK_NSEC,
+	.shift  = 0
+};
+
+static struct timekeeper tk = {
+	.lock           = SEQLOCK_INIT,
+	.clock          = &clocksource_jiffies,
+	.cycle_last     = 0,
+	.base_ns        = 0,
+	.jiffies_64     = 0
+};
+
+/* timekeeping_delta_ns: nanoseconds since the base was last advanced */
+static __always_inline uint64_t timekeeping_delta_ns(void)
+{
+	struct clocksource *cs;
+	uint64_t delta;
+
+	cs = tk.clock;
+	delta = (cs->read(cs) - tk.cycle_last) & cs->mask;
+	return mul_u64_u32_shr(delta, cs->mult, cs->shift);
+}
+
+/* timekeeping_forward: advance the base to the current time */
+static void timekeeping_forward(void)
+{
+	uint64_t now;
+
+	now = tk.clock->read(tk.clock);
+	tk.base_ns += mul_u64_u32_shr((now - tk.cycle_last) & tk.clock->mask,
+	                              tk.clock->mult, tk.clock->shift);
+	tk.cycle_last = now;
+}
+
+/*
+ * ktime_get_ns:
+ * Return the number of nanoseconds since boot.
+ */
+uint64_t ktime_get_ns(void)
+{
+	uint64_t ns;
+	unsigned int seq;
+
+	do {
+		seq = read_seqbegin(&tk.lock);
+		ns = tk.base_ns + timekeeping_delta_ns();
+	} while (read_seqretry(&tk.lock, seq));
+
+	return ns;
+}
+
+ktime_t ktime_get(void)
+{
+	return ns_to_ktime(ktime_get_ns());
+}
+
+uint64_t get_jiffies_64(void)
+{
+	uint64_t ret;
+	unsigned int seq;
+
+	do {
+		seq = read_seqbegin(&tk.lock);
+		ret = tk.jiffies_64;
+	} while (read_seqretry(&tk.lock, seq));
+
+	return ret;
+}
+
+/*
+ * timekeeping_set_clock:
+ * Switch timekeeping to clocksource `cs`.
+ */
+void timekeeping_set_clock(struct clocksource *cs)
+{
+	unsigned long flags;
+
+	write_seqlock_irqsave(&tk.lock, flags);
+	if (tk.clock != cs) {
+		timekeeping_forward();
+		tk.clock = cs;
+		tk.cycle_last = cs->read(cs);
+	}
+	write_sequnlock_irqrestore(&tk.lock, flags);
+}
+
+/*
+ * timekeeping_continuous:
+ * Return 1 if the time can be read at a finer resolution than ticks.
+ */
+int timekeeping_continuous(void)
+{
+	return READ_ONCE(tk.clock) != &clocksource_jiffies;
+}
+
+/*
+ * timekeeping_tick:
+ * Advance the time by `ticks` timer ticks. Called from the tick handler
+ * of a single processor.
+ */
+void timekeeping_tick(unsigned int ticks)
+{
+	unsigned long flags;
+
+	write_seqlock_irqsave(&tk.lock, flags);
+	if (tk.clock == &clocksource_jiffies) {
+		tk.jiffies_64 += ticks;
+		timekeeping_forward();
+	} else {
+		/* tick interrupts can be late; derive jiffies from the clock */
+		timekeeping_forward();
+		tk.jiffies_64 = div_u64(tk.base_ns, TICK_NSEC);
+	}
+	jiffies = (unsigned long)tk.jiffies_64;
+	write_sequnlock_irqrestore(&tk.lock, flags);
+}
@@ -0,0 +1,28 @@
+/*
+ * kernel/time/timekeeping.h
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KERNEL_TIME_TIMEKEEPING_H
+#define KERNEL_TIME_TIMEKEEPING_H
+
+struct clocksource;
+
+void timekeeping_set_clock(struct clocksource *cs);
+void timekeeping_tick(unsigned int ticks);
+int timekeeping_continuous(void);
+
+#endif /* KERNEL_TIME_TIMEKEEPING_H */
@@ -0,0 +1,411 @@
+/*
+ * kernel/time/timer.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/bitops.h>
+#include <radix/cpu.h>
+#include <radix/error.h>
+#include <radix/irq.h>
+#include <radix/kernel.h>
+#include <radix/percpu.h>
+#include <radix/sched.h>
+#include <radix/smp.h>
+#include <radix/spinlock.h>
+#include <radix/tasking.h>
+#include <radix/tick.h>
+#include <radix/timer.h>
+
+/*
+ * Timers are kept in a hierarchical timing wheel on each processor.
+ *
+ * The first level has one slot for each of the next TVR_SIZE jiffies.
+ * Each further level has TVN_SIZE slots, each covering an entire rotation
+ * of the level below it. Adding or deleting a timer is a list operation
+ * on the slot its expiry time falls into. Whenever the first level wraps
+ * around, the next slot of the second level is emptied into it, and so on
+ * up the hierarchy, so each timer is moved at most once per level.
+ *
+ * A bitmap of the non-empty first level slots lets empty jiffies be
+ * skipped, and bounds the time until the next timer may expire.
+ */
+#define TVN_BITS        6
+#define TVR_BITS        8
+#define TVN_SIZE        (1 << TVN_BITS)
+#define TVR_SIZE        (1 << TVR_BITS)
+#define TVN_MASK        (TVN_SIZE - 1)
+#define TVR_MASK        (TVR_SIZE - 1)
+#define TVN_LEVELS      4
+
+struct timer_base {
+	spinlock_t              lock;
+	unsigned long           clk;            /* next jiffy to process */
+	unsigned int            nr_pending;
+	DECLARE_BITMAP(tv1_pending, TVR_SIZE);
+	struct list             tv1[TVR_SIZE];
+	struct list             tvn[TVN_LEVELS][TVN_SIZE];
+};
+
+static DEFINE_PER_CPU(struct timer_base, timer_bases);
+
+/* tvn_index: return the slot in level `n` for time `clk` */
+#define tvn_index(clk, n) \
+	(((clk) >> (TVR_BITS + (n) * TVN_BITS)) & TVN_MASK)
+
+static void internal_add_timer(struct timer_base *base,
+                               struct timer_list *timer)
+{
+	unsigned long expires, idx;
+	struct list *vec;
+	int i;
+
+	expires = timer->expires;
+	idx = expires - base->clk;
+
+	if ((long)idx < 0) {
+		/* already expired; run it on the next jiffy processed */
+		expires = base->clk;
+		idx = 0;
+	}
+
+	if (idx < TVR_SIZE) {
+		i = expires & TVR_MASK;
+		vec = &base->tv1[i];
+		__set_bit(i, base->tv1_pending);
+	} else {
+		for (i = 0; i < TVN_LEVELS - 1; ++i) {
+			if (idx < 1UL << (TVR_BITS + (i + 1) * TVN_BITS))
+				break;
+		}
+		vec = &base->tvn[i][tvn_index(expires, i)];
+	}
+
+	list_ins(vec, &timer->entry);
+	timer->base = base;
+}
+
+static void detach_timer(struct timer_base *base, struct timer_list *timer)
+{
+	unsigned int i;
+
+	list_del(&timer->entry);
+	timer->base = NULL;
+
+	/* clear the bitmap entry when removing from an emptied tv1 slot */
+	if (!time_after(timer->expires, base->clk + TVR_MASK) &&
+	    !time_before(timer->expires, base->clk)) {
+		i = timer->expires & TVR_MASK;
+		if (list_empty(&base->tv1[i]))
+			__clear_bit(i, base->tv1_pending);
+	}
+}
+
+/*
+ * cascade:
+ * Move the timers in slot `index` of level `n` down the wheel.
+ * Return `index`, which is zero if the level has wrapped around.
+ */
+static int cascade(struct timer_base *base, int n, int index)
+{
+	struct list head, *vec;
+	struct timer_list *timer;
+
+	vec = &base->tvn[n][index];
+	if (list_empty(vec))
+		return index;
+
+	/* take the whole slot, as timers may be added back into it */
+	list_init(&head);
+	list_ins(vec, &head);
+	list_del(vec);
+	list_init(vec);
+
+	while (!list_empty(&head)) {
+		timer = list_first_entry(&head, struct timer_list, entry);
+		list_del(&timer->entry);
+		internal_add_timer(base, timer);
+	}
+
+	return index;
+}
+
+/*
+ * timer_base_next:
+ * Return the jiffy after base->clk at which timers may next need to be
+ * processed: the next non-empty first level slot, or the next cascade.
+ */
+static unsigned long timer_base_next(struct timer_base *base)
+{
+	unsigned long index, next;
+
+	index = base->clk & TVR_MASK;
+	next = find_next_bit(base->tv1_pending, TVR_SIZE, index);
+
+	return base->clk + (next - index);
+}
+
+static void run_timer_base(struct timer_base *base)
+{
+	struct timer_list *timer;
+	struct list work, *vec;
+	void (*fn)(void *);
+	void *data;
+	unsigned long index, now, next;
+	int n;
+
+	spin_lock(&base->lock);
+	now = jiffies;
+
+	while (time_after_eq(now, base->clk)) {
+		if (!base->nr_pending) {
+			base->clk = now + 1;
+			break;
+		}
+
+		index = base->clk & TVR_MASK;
+		if (!index) {
+			for (n = 0; n < TVN_LEVELS; ++n) {
+				if (cascade(base, n, tvn_index(base->clk, n)))
+					break;
+			}
+		}
+
+		/*
+		 * Take the expired timers before advancing the clock, so that
+		 * any which are re-added from their functions go into a slot
+		 * which has yet to be processed.
+		 */
+		vec = &base->tv1[index];
+		list_init(&work);
+		if (!list_empty(vec)) {
+			list_ins(vec, &work);
+			list_del(vec);
+			list_init(vec);
+		}
+		__clear_bit(index, base->tv1_pending);
+		base->clk++;
+
+		while (!list_empty(&work)) {
+			timer = list_first_entry(&work, struct timer_list, entry);
+			fn = timer->function;
+			data = timer->data;
+
+			list_del(&timer->entry);
+			WRITE_ONCE(timer->base, NULL);
+			base->nr_pending--;
+
+			/* the timer may be freed or re-added by its function */
+			spin_unlock(&base->lock);
+			fn(data);
+			spin_lock(&base->lock);
+		}
+
+		/* skip over empty slots, stopping at the next cascade */
+		if (time_after_eq(now, base->clk)) {
+			next = timer_base_next(base);
+			base->clk = time_after(next, now + 1) ? now + 1 : next;
+		}
+	}
+
+	spin_unlock(&base->lock);
+}
+
+/*
+ * timers_run:
+ * Run the expired timers of the executing processor.
+ * Called from its tick handler.
+ */
+void timers_run(void)
+{
+	unsigned long flags;
+
+	irq_save(flags);
+	run_timer_base(raw_cpu_ptr(&timer_bases));
+	irq_restore(flags);
+}
+
+/*
+ * timer_next_tick:
+ * Return the number of ticks until the executing processor's timer wheel
+ * next needs to run, for the tick to be stopped.
+ */
+unsigned int timer_next_tick(void)
+{
+	struct timer_base *base;
+	unsigned long flags, next, now;
+	unsigned int ret;
+
+	irq_save(flags);
+	base = raw_cpu_ptr(&timer_bases);
+	spin_lock(&base->lock);
+
+	ret = ~0U;
+	if (base->nr_pending) {
+		now = jiffies;
+		next = timer_base_next(base);
+		ret = time_after(next, now) ? next - now : 1;
+	}
+
+	spin_unlock(&base->lock);
+	irq_restore(flags);
+
+	return ret;
+}
+
+/*
+ * timer_add:
+ * Start `timer`, which expires at `timer->expires`, on the executing
+ * processor. Returns EBUSY if the timer is already pending.
+ */
+int timer_add(struct timer_list *timer)
+{
+	struct timer_base *base;
+	unsigned long flags;
+
+	if (timer_pending(timer))
+		return EBUSY;
+
+	irq_save(flags);
+	base = raw_cpu_ptr(&timer_bases);
+	spin_lock(&base->lock);
+	internal_add_timer(base, timer);
+	base->nr_pending++;
+	spin_unlock(&base->lock);
+
+	/* the tick may be stopped beyond the new timer's expiry */
+	tick_nohz_kick(processor_id());
+	irq_restore(flags);
+
+	return 0;
+}
+
+/*
+ * timer_del:
+ * Stop `timer` if it is pending. Returns 1 if the timer was pending.
+ * Does not wait for the timer's function if it is already running.
+ */
+int timer_del(struct timer_list *timer)
+{
+	struct timer_base *base;
+	unsigned long flags;
+
+	irq_save(flags);
+	while ((base = READ_ONCE(timer->base))) {
+		spin_lock(&base->lock);
+		if (timer->base == base) {
+			detach_timer(base, timer);
+			base->nr_pending--;
+			spin_unlock(&base->lock);
+			irq_restore(flags);
+			return 1;
+		}
+		/* the timer expired or moved while taking the lock */
+		spin_unlock(&base->lock);
+	}
+	irq_restore(flags);
+
+	return 0;
+}
+
+/* timer_mod: change the expiry time of `timer`, starting it if necessary */
+int timer_mod(struct timer_list *timer, unsigned long expires)
+{
+	int ret;
+
+	ret = timer_del(timer);
+	timer->expires = expires;
+	timer_add(timer);
+
+	return ret;
+}
+
+static void process_timeout(void *data)
+{
+	struct task *t;
+
+	t = data;
+	if (t->state == TASK_BLOCKED)
+		sched_unblock(t);
+}
+
+/*
+ * schedule_timeout:
+ * Block the current task for up to `timeout` jiffies. The caller must have
+ * set its state to TASK_BLOCKED; it may be woken earlier by sched_unblock.
+ * Returns the number of jiffies remaining until the timeout.
+ */
+long schedule_timeout(long timeout)
+{
+	struct timer_list timer;
+	unsigned long expires;
+
+	if (timeout == MAX_SCHEDULE_TIMEOUT) {
+		schedule(1);
+		return timeout;
+	}
+
+	if (timeout < 0)
+		timeout = 0;
+
+	expires = jiffies + timeout;
+	timer_init(&timer, process_timeout, current_task());
+	timer.expires = expires;
+	timer_add(&timer);
+
+	schedule(1);
+	timer_del(&timer);
+
+	timeout = expires - jiffies;
+	return timeout < 0 ? 0 : timeout;
+}
+
+/*
+ * msleep:
+ * Sleep for at least `msecs` milliseconds.
+ */
+void msleep(unsigned int msecs)
+{
+	long timeout;
+
+	/* add a jiffy, as the current one is already partly over */
+	timeout = msecs_to_jiffies(msecs) + 1;
+
+	while (timeout) {
+		irq_disable();
+		current_task()->state = TASK_BLOCKED;
+		timeout = schedule_timeout(timeout);
+		irq_enable();
+	}
+}
+
+void timers_init(void)
+{
+	struct timer_base *base;
+	int cpu, i, n;
+
+	for (cpu = 0; cpu < (int)possible_cpus(); ++cpu) {
+		base = per_cpu_ptr(&timer_bases, cpu);
+		spin_init(&base->lock);
+		base->clk = jiffies;
+		base->nr_pending = 0;
+		for (i = 0; i < TVR_SIZE; ++i)
+			list_init(&base->tv1[i]);
+		for (n = 0; n < TVN_LEVELS; ++n) {
+			for (i = 0; i < TVN_SIZE; ++i)
+				list_init(&base->tvn[n][i]);
+		}
+	}
+}
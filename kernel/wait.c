@@ -0,0 +1,124 @@
+/*
+ * kernel/wait.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/atomic.h>
+#include <radix/irq.h>
+#include <radix/sched.h>
+#include <radix/wait.h>
+
+void wait_queue_head_init(struct wait_queue_head *wq)
+{
+	spin_init(&wq->lock);
+	list_init(&wq->head);
+}
+
+void wait_entry_init(struct wait_queue_entry *wait, int flags)
+{
+	list_init(&wait->list);
+	wait->task = current_task();
+	wait->flags = flags;
+}
+
+/*
+ * prepare_to_wait:
+ * Queue `wait` on `wq`, if it is not already, and mark the current task
+ * as blocked. The caller should then check its wait condition and call
+ * schedule if it is false.
+ */
+void prepare_to_wait(struct wait_queue_head *wq, struct wait_queue_entry *wait)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&wq->lock, flags);
+	if (list_empty(&wait->list)) {
+		if (wait->flags & WQ_FLAG_EXCLUSIVE)
+			list_ins(&wq->head, &wait->list);
+		else
+			list_add(&wq->head, &wait->list);
+	}
+	wait->task->state = TASK_BLOCKED;
+	spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+/*
+ * finish_wait:
+ * Remove `wait` from `wq` once the current task has stopped waiting.
+ */
+void finish_wait(struct wait_queue_head *wq, struct wait_queue_entry *wait)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&wq->lock, flags);
+	if (!list_empty(&wait->list))
+		list_del(&wait->list);
+	spin_unlock_irqrestore(&wq->lock, flags);
+
+	/*
+	 * If a waker got to the task after its condition became true, it is
+	 * already back on a run queue and must not be marked running here.
+	 * Let the scheduler pick it up from there instead. As the task was
+	 * still on its processor when woken, it was queued there and cannot
+	 * have been picked up by another processor in the meantime.
+	 */
+	if (cmpxchg(&wait->task->state, TASK_BLOCKED, TASK_RUNNING) ==
+	    TASK_READY)
+		schedule(1);
+}
+
+/*
+ * __wake_up:
+ * Wake the tasks waiting on `wq`: every non-exclusive waiter, followed by
+ * up to `nr_exclusive` exclusive waiters, or all of them if it is 0.
+ * Woken waiters are removed from the queue.
+ */
+void __wake_up(struct wait_queue_head *wq, int nr_exclusive)
+{
+	struct wait_queue_entry *wait;
+	struct list *pos, *tmp;
+	unsigned long flags;
+
+	spin_lock_irqsave(&wq->lock, flags);
+	list_for_each_safe(pos, tmp, &wq->head) {
+		wait = list_entry(pos, struct wait_queue_entry, list);
+		if (!sched_unblock(wait->task))
+			continue;
+
+		list_del(&wait->list);
+		if ((wait->flags & WQ_FLAG_EXCLUSIVE) && !--nr_exclusive)
+			break;
+	}
+	spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+/* wake_up_one: wake the first task waiting on `wq`, exclusive or not */
+void wake_up_one(struct wait_queue_head *wq)
+{
+	struct wait_queue_entry *wait;
+	struct list *pos, *tmp;
+	unsigned long flags;
+
+	spin_lock_irqsave(&wq->lock, flags);
+	list_for_each_safe(pos, tmp, &wq->head) {
+		wait = list_entry(pos, struct wait_queue_entry, list);
+		if (sched_unblock(wait->task)) {
+			list_del(&wait->list);
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&wq->lock, flags);
+}
@@ -0,0 +1,175 @@
+/*
+ * kernel/workqueue.c
+ * Copyright (C) 2016-2017 Alexei Frolov
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radix/bitops.h>
+#include <radix/cpumask.h>
+#include <radix/error.h>
+#include <radix/kernel.h>
+#include <radix/kthread.h>
+#include <radix/percpu.h>
+#include <radix/sched.h>
+#include <radix/smp.h>
+#include <radix/spinlock.h>
+#include <radix/wait.h>
+#include <radix/workqueue.h>
+
+#include <rlibc/string.h>
+
+/* Number of worker threads started on each processor. */
+#define WORKERS_PER_CPU 4
+
+/*
+ * Each processor has a pool of worker threads, bound to it, which start
+ * the work queued on that processor in the order in which it was queued.
+ * A worker takes one work item at a time, so a work item which sleeps
+ * only holds up the rest once every worker in the pool is busy.
+ *
+ * Work is added to a lock-free list; only the addition which makes the
+ * list non-empty has to wake a worker. Workers move the list in queued
+ * order to `queue` and take items from it under `lock`, waking another
+ * worker if any are left.
+ */
+struct worker_pool {
+	struct llist_head       list;
+	spinlock_t              lock;
+	struct llist_node       *queue;
+	struct wait_queue_head  wait;
+	unsigned int            nr_workers;
+};
+
+static DEFINE_PER_CPU(struct worker_pool, worker_pools);
+
+static int pool_has_work(struct worker_pool *pool)
+{
+	return READ_ONCE(pool->queue) || !llist_empty(&pool->list);
+}
+
+/* pool_take_work: remove and return the oldest work item in `pool` */
+static struct work_struct *pool_take_work(struct worker_pool *pool)
+{
+	struct llist_node *node;
+	int more;
+
+	spin_lock(&pool->lock);
+	if (!pool->queue)
+		pool->queue = llist_reverse_order(llist_del_all(&pool->list));
+
+	node = pool->queue;
+	if (node)
+		pool->queue = node->next;
+	more = pool_has_work(pool);
+	spin_unlock(&pool->lock);
+
+	if (more)
+		wake_up(&pool->wait);
+
+	return node ? llist_entry(node, struct work_struct, node) : NULL;
+}
+
+static void worker_thread(void *arg)
+{
+	struct worker_pool *pool;
+	struct work_struct *work;
+
+	pool = arg;
+	while (1) {
+		wait_event_exclusive(pool->wait, pool_has_work(pool));
+
+		while ((work = pool_take_work(pool))) {
+			/* the work may be queued again once it has started */
+			clear_bit(WORK_STRUCT_PENDING, &work->pending);
+			work->func(work);
+		}
+	}
+}
+
+/*
+ * schedule_work_on:
+ * Queue `work` to run on processor `cpu`.
+ * Return 1 if it was queued, or 0 if it was already pending.
+ */
+int schedule_work_on(unsigned int cpu, struct work_struct *work)
+{
+	struct worker_pool *pool;
+
+	if (test_and_set_bit(WORK_STRUCT_PENDING, &work->pending))
+		return 0;
+
+	pool = per_cpu_ptr(&worker_pools, cpu);
+	if (llist_add(&work->node, &pool->list) && READ_ONCE(pool->nr_workers))
+		wake_up(&pool->wait);
+
+	return 1;
+}
+
+/*
+ * schedule_work:
+ * Queue `work` to run on the executing processor.
+ * Return 1 if it was queued, or 0 if it was already pending.
+ */
+int schedule_work(struct work_struct *work)
+{
+	return schedule_work_on(processor_id(), work);
+}
+
+/* start_worker: start worker thread `n` of `pool`, bound to processor `cpu` */
+static void start_worker(struct worker_pool *pool, unsigned int cpu,
+                         unsigned int n)
+{
+	struct task *worker;
+
+	worker = kthread_create(worker_thread, pool, 0,
+	                        "kworker/%u:%u", cpu, n);
+	if (IS_ERR(worker))
+		panic("failed to create worker thread for CPU %u: %s\n",
+		      cpu, strerror(ERR_VAL(worker)));
+
+	cpumask_clear(&worker->cpus_allowed);
+	cpumask_set_cpu(cpu, &worker->cpus_allowed);
+	worker->cpu = cpu;
+
+	/*
+	 * Workers run deferred interrupt work, so they should not
+	 * wait behind SCHED_NORMAL tasks to do so.
+	 */
+	sched_setscheduler(worker, SCHED_PRIO, SCHED_PRIO_DEFAULT);
+
+	WRITE_ONCE(pool->nr_workers, pool->nr_workers + 1);
+	kthread_start(worker);
+}
+
+/*
+ * workqueues_init:
+ * Start the worker threads on each processor. Work queued before then is
+ * run as soon as its processor's first worker starts.
+ */
+void workqueues_init(void)
+{
+	struct worker_pool *pool;
+	unsigned int cpu, i;
+
+	for_each_online_cpu(cpu) {
+		pool = per_cpu_ptr(&worker_pools, cpu);
+		spin_init(&pool->lock);
+		pool->queue = NULL;
+		wait_queue_head_init(&pool->wait);
+
+		for (i = 0; i < WORKERS_PER_CPU; ++i)
+			start_worker(pool, cpu, i);
+	}
+}